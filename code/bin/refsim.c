@@ -0,0 +1,319 @@
+/// Program that replays a page reference log against several page
+/// replacement policies, and prints their fault curves.
+///
+/// The log is produced by running Nachos with `-rl <file>`; its format is
+/// described in `machine/reference_log.hh`.  For each number of physical
+/// frames, the faults under FIFO, clock, LRU and Belady's optimal policy are
+/// printed; then, for each window size, the faults and mean resident size of
+/// the working set policy.
+///
+/// Consecutive references to the same page are folded into one before
+/// simulating, since they can never fault under any of the policies.
+/// Window sizes are therefore measured in folded references.
+///
+/// Usage:
+///
+///     refsim [-s <space>] [-f <max frames>] [-w <max window>] <log file>
+///
+/// By default, the references of all address spaces are replayed together,
+/// as if they shared a global pool of frames; `-s` selects a single one.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Keep in sync with `machine/reference_log.hh`.
+#define REF_LOG_MAGIC  0x4E524546
+#define REF_LOG_WRITE  0x80000000
+
+typedef struct {
+    uint32_t space;
+    uint32_t vpn;
+    uint32_t count;
+} ReferenceRecord;
+
+
+/// The folded reference string, with pages renamed to `0..numPages-1`.
+static unsigned *refs;
+static unsigned numRefs;
+static unsigned numPages;
+
+static void *
+Allocate(size_t count, size_t size)
+{
+    void *p = calloc(count == 0 ? 1 : count, size);
+    if (p == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static int
+CompareKeys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+/// Read the log at `path`, keeping only space `space` unless it is
+/// negative.  Returns the number of raw references kept, or -1 on error.
+static long long
+Load(const char *path, long space)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    uint32_t magic;
+    if (fread(&magic, sizeof magic, 1, f) != 1 || magic != REF_LOG_MAGIC) {
+        fprintf(stderr, "%s: not a reference log\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    size_t capacity = 1024;
+    uint64_t *keys = Allocate(capacity, sizeof *keys);
+    long long numRaw = 0;
+    ReferenceRecord r;
+    while (fread(&r, sizeof r, 1, f) == 1) {
+        if (space >= 0 && r.space != (uint32_t) space)
+            continue;
+        uint64_t key = (uint64_t) r.space << 32 | (r.vpn & ~REF_LOG_WRITE);
+        numRaw += r.count;
+        if (numRefs > 0 && keys[numRefs - 1] == key)
+            continue;  // Runs may be split across spaces being filtered.
+        if (numRefs == capacity) {
+            capacity *= 2;
+            keys = realloc(keys, capacity * sizeof *keys);
+            if (keys == NULL) {
+                fprintf(stderr, "Out of memory.\n");
+                exit(1);
+            }
+        }
+        keys[numRefs++] = key;
+    }
+    fclose(f);
+
+    // Rename pages to dense identifiers.
+    uint64_t *sorted = Allocate(numRefs, sizeof *sorted);
+    memcpy(sorted, keys, numRefs * sizeof *sorted);
+    qsort(sorted, numRefs, sizeof *sorted, CompareKeys);
+    for (unsigned i = 0; i < numRefs; i++)
+        if (i == 0 || sorted[i] != sorted[numPages - 1])
+            sorted[numPages++] = sorted[i];
+
+    refs = Allocate(numRefs, sizeof *refs);
+    for (unsigned i = 0; i < numRefs; i++) {
+        uint64_t *p = bsearch(&keys[i], sorted, numPages, sizeof *sorted,
+                              CompareKeys);
+        refs[i] = p - sorted;
+    }
+
+    free(sorted);
+    free(keys);
+    return numRaw;
+}
+
+/// Policies choose a victim among `frames[0..numFrames-1]` (page
+/// identifiers); `resident[page]` is the frame holding `page`, or -1.
+typedef struct {
+    unsigned numFrames;
+    unsigned used;
+    unsigned *frames;
+    int *resident;
+    unsigned hand;
+    unsigned *stamp;  ///< Per page: last use (LRU) or next use (OPT).
+    char *useBit;     ///< Per frame (clock).
+} Memory;
+
+enum Policy { FIFO, CLOCK, LRU, OPT, NUM_POLICIES };
+
+static const char *POLICY_NAMES[] = { "FIFO", "Clock", "LRU", "OPT" };
+
+static unsigned long
+Simulate(enum Policy policy, unsigned numFrames, const unsigned *next)
+{
+    Memory m;
+    m.numFrames = numFrames;
+    m.used      = 0;
+    m.hand      = 0;
+    m.frames    = Allocate(numFrames, sizeof *m.frames);
+    m.useBit    = Allocate(numFrames, sizeof *m.useBit);
+    m.resident  = Allocate(numPages, sizeof *m.resident);
+    m.stamp     = Allocate(numPages, sizeof *m.stamp);
+    for (unsigned p = 0; p < numPages; p++)
+        m.resident[p] = -1;
+
+    unsigned long faults = 0;
+    for (unsigned i = 0; i < numRefs; i++) {
+        unsigned page = refs[i];
+        int frame = m.resident[page];
+
+        if (frame == -1) {
+            faults++;
+            if (m.used < numFrames)
+                frame = m.used++;
+            else {
+                switch (policy) {
+                    case FIFO:
+                        frame = m.hand;
+                        m.hand = (m.hand + 1) % numFrames;
+                        break;
+                    case CLOCK:
+                        while (m.useBit[m.hand]) {
+                            m.useBit[m.hand] = 0;
+                            m.hand = (m.hand + 1) % numFrames;
+                        }
+                        frame = m.hand;
+                        m.hand = (m.hand + 1) % numFrames;
+                        break;
+                    case LRU:  // Evict the smallest last use.
+                    case OPT:  // Evict the greatest next use.
+                        frame = 0;
+                        for (unsigned j = 1; j < numFrames; j++) {
+                            unsigned a = m.stamp[m.frames[j]];
+                            unsigned b = m.stamp[m.frames[frame]];
+                            if (policy == LRU ? a < b : a > b)
+                                frame = j;
+                        }
+                        break;
+                    default:
+                        abort();
+                }
+                m.resident[m.frames[frame]] = -1;
+            }
+            m.frames[frame] = page;
+            m.resident[page] = frame;
+        }
+
+        m.useBit[frame] = 1;
+        m.stamp[page] = policy == OPT ? next[i] : i;
+    }
+
+    free(m.frames);
+    free(m.useBit);
+    free(m.resident);
+    free(m.stamp);
+    return faults;
+}
+
+/// Working set with window `window`: a page is resident while it has been
+/// referenced in the last `window` references.
+static unsigned long
+SimulateWorkingSet(unsigned window, double *meanSize)
+{
+    long *lastUse = Allocate(numPages, sizeof *lastUse);
+    for (unsigned p = 0; p < numPages; p++)
+        lastUse[p] = -1;
+
+    unsigned long faults = 0;
+    unsigned long size = 0;
+    double sizeSum = 0;
+    for (unsigned i = 0; i < numRefs; i++) {
+        unsigned page = refs[i];
+        long start = (long) i - (long) window;  // Oldest reference kept.
+
+        if (lastUse[page] == -1 || lastUse[page] < start)
+            faults++;
+
+        // Slide the window: drop reference `start`, add reference `i`.
+        if (start >= 0 && lastUse[refs[start]] == start)
+            size--;
+        if (lastUse[page] == -1 || lastUse[page] <= start)
+            size++;
+        lastUse[page] = i;
+        sizeSum += size;
+    }
+
+    free(lastUse);
+    *meanSize = numRefs == 0 ? 0 : sizeSum / numRefs;
+    return faults;
+}
+
+static void
+Usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [-s <space>] [-f <max frames>] "
+                    "[-w <max window>] <log file>\n", program);
+    exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+    long space = -1;
+    unsigned maxFrames = 32;
+    unsigned maxWindow = 1024;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            space = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+            maxFrames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+            maxWindow = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+            Usage(argv[0]);
+    }
+    if (path == NULL || maxFrames == 0 || maxWindow == 0)
+        Usage(argv[0]);
+
+    long long numRaw = Load(path, space);
+    if (numRaw < 0)
+        return 1;
+
+    printf("%s: %lld references, %u after folding, %u distinct pages\n",
+           path, numRaw, numRefs, numPages);
+    if (space >= 0)
+        printf("Address space: %ld\n", space);
+
+    // Next use of the page referenced at each position, for OPT.
+    unsigned *next = Allocate(numRefs, sizeof *next);
+    unsigned *seen = Allocate(numPages, sizeof *seen);
+    for (unsigned p = 0; p < numPages; p++)
+        seen[p] = numRefs;
+    for (unsigned i = numRefs; i-- > 0;) {
+        next[i] = seen[refs[i]];
+        seen[refs[i]] = i;
+    }
+    free(seen);
+
+    printf("\n%8s", "Frames");
+    for (int p = 0; p < NUM_POLICIES; p++)
+        printf(" %10s", POLICY_NAMES[p]);
+    printf("\n");
+    for (unsigned frames = 1; frames <= maxFrames; frames++) {
+        printf("%8u", frames);
+        for (int p = 0; p < NUM_POLICIES; p++)
+            printf(" %10lu", Simulate(p, frames, next));
+        printf("\n");
+        if (frames >= numPages)
+            break;  // Only compulsory faults from here on.
+    }
+
+    printf("\n%8s %10s %10s\n", "Window", "WS faults", "Mean size");
+    for (unsigned window = 1; window <= maxWindow; window *= 2) {
+        double meanSize;
+        unsigned long faults = SimulateWorkingSet(window, &meanSize);
+        printf("%8u %10lu %10.2f\n", window, faults, meanSize);
+        if (window >= numRefs)
+            break;
+    }
+
+    free(next);
+    free(refs);
+    return 0;
+}
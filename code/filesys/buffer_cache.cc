@@ -0,0 +1,496 @@
+/// Routines to cache disk sectors in memory.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "buffer_cache.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+static const char *const POLICY_NAMES[] = { "lru", "2q" };
+
+bool
+ParseCachePolicy(const char *name, CachePolicy *policy)
+{
+    ASSERT(name != nullptr);
+    ASSERT(policy != nullptr);
+
+    for (unsigned i = 0; i < NUM_CACHE_POLICIES; i++) {
+        if (!strcmp(name, POLICY_NAMES[i])) {
+            *policy = (CachePolicy) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+BufferCache::BufferCache(SynchDisk *rawDisk, unsigned size,
+                         CachePolicy cachePolicy, unsigned readAheadLimit,
+                         unsigned long writeBehind)
+{
+    ASSERT(rawDisk != nullptr);
+    ASSERT(cachePolicy < NUM_CACHE_POLICIES);
+
+    disk       = rawDisk;
+    policy     = cachePolicy;
+    numBuffers = size;
+    buffers    = new CacheBuffer [numBuffers];
+    for (unsigned i = 0; i < numBuffers; i++) {
+        buffers[i].sector    = -1;
+        buffers[i].valid     = false;
+        buffers[i].dirty     = false;
+        buffers[i].busy      = false;
+        buffers[i].hot       = false;
+        buffers[i].readAhead  = false;
+        buffers[i].dirtySince = 0;
+        buffers[i].hashNext   = nullptr;
+        freeBuffers.Append(&buffers[i]);
+    }
+
+    unsigned numChains = 1;
+    while (numChains < numBuffers)
+        numChains *= 2;
+    hashMask  = numChains - 1;
+    hashTable = new CacheBuffer * [numChains];
+    for (unsigned i = 0; i < numChains; i++)
+        hashTable[i] = nullptr;
+
+    numRecent     = 0;
+    recentLimit   = numBuffers / 4 > 0 ? numBuffers / 4 : 1;
+    ghostCapacity = numBuffers / 2 > 0 ? numBuffers / 2 : 1;
+    ghosts        = new int [ghostCapacity];
+    ghostHead     = 0;
+    numGhosts     = 0;
+
+    maxReadAhead     = readAheadLimit < numBuffers / 4 ? readAheadLimit
+                                                       : numBuffers / 4;
+    pendingCapacity  = 2 * maxReadAhead;
+    pending          = new int [pendingCapacity];
+    pendingHead      = 0;
+    numPending       = 0;
+    readAheadRunning = false;
+
+    numDirty           = 0;
+    dirtyLimit         = numBuffers / 2 > 0 ? numBuffers / 2 : 1;
+    writeBehindAge     = writeBehind;
+    writeBehindRunning = false;
+
+    lock   = new Lock("buffer cache");
+    ioDone = new Condition("buffer cache i/o", lock);
+}
+
+BufferCache::~BufferCache()
+{
+    delete ioDone;
+    delete [] pending;
+    delete lock;
+    delete [] ghosts;
+    delete [] hashTable;
+    delete [] buffers;
+}
+
+/// A miss only reads the sector after the buffer has been taken, so other
+/// threads looking for the same sector meanwhile wait for the read instead
+/// of issuing their own.
+void
+BufferCache::ReadSector(int sector, char *data)
+{
+    ASSERT(data != nullptr);
+
+    if (numBuffers == 0) {
+        disk->ReadSector(sector, data);
+        return;
+    }
+
+    lock->Acquire();
+    CacheBuffer *buffer;
+    for (;;) {
+        if ((buffer = Find(sector)) != nullptr) {
+            stats->numCacheHits++;
+            if (buffer->readAhead) {
+                stats->numReadAheadHits++;
+                buffer->readAhead = false;
+            }
+            Touch(buffer);
+            break;
+        }
+        if ((buffer = Allocate(sector)) != nullptr) {
+            stats->numCacheMisses++;
+            Fill(buffer);
+            break;
+        }
+    }
+    memcpy(data, buffer->data, SECTOR_SIZE);
+    lock->Release();
+}
+
+void
+BufferCache::WriteSector(int sector, const char *data)
+{
+    WriteBytes(sector, data, 0, SECTOR_SIZE);
+}
+
+/// A write of the whole sector does not read the old contents on a miss.
+void
+BufferCache::WriteBytes(int sector, const char *data,
+                        unsigned offset, unsigned numBytes)
+{
+    ASSERT(data != nullptr);
+    ASSERT(numBytes > 0 && offset + numBytes <= SECTOR_SIZE);
+
+    bool whole = numBytes == SECTOR_SIZE;
+    if (numBuffers == 0) {
+        if (whole)
+            disk->WriteSector(sector, data);
+        else {
+            char buf[SECTOR_SIZE];
+            disk->ReadSector(sector, buf);
+            memcpy(&buf[offset], data, numBytes);
+            disk->WriteSector(sector, buf);
+        }
+        return;
+    }
+
+    lock->Acquire();
+    CacheBuffer *buffer;
+    for (;;) {
+        if ((buffer = Find(sector)) != nullptr) {
+            stats->numCacheHits++;
+            buffer->readAhead = false;
+            Touch(buffer);
+            break;
+        }
+        if ((buffer = Allocate(sector)) != nullptr) {
+            stats->numCacheMisses++;
+            if (whole) {
+                buffer->valid = true;
+                buffer->busy  = false;
+            } else
+                Fill(buffer);
+            break;
+        }
+    }
+    memcpy(&buffer->data[offset], data, numBytes);
+    if (!buffer->dirty) {
+        buffer->dirty      = true;
+        buffer->dirtySince = stats->totalTicks;
+        numDirty++;
+        if (writeBehindAge > 0 && !writeBehindRunning) {
+            writeBehindRunning = true;
+            Thread *t = new Thread("write behind");
+            t->Fork(WriteBehindThread, this);
+        }
+    }
+
+    // Too many modified sectors: do not wait for the write-behind thread.
+    while (numDirty > dirtyLimit && (buffer = OldestDirty()) != nullptr)
+        WriteBack(buffer);
+    lock->Release();
+}
+
+void
+BufferCache::Flush()
+{
+    if (numBuffers == 0)
+        return;
+
+    lock->Acquire();
+    while (numDirty > 0) {
+        CacheBuffer *buffer = OldestDirty();
+        if (buffer != nullptr)
+            WriteBack(buffer);
+        else
+            ioDone->Wait();  // The rest are being written back.
+    }
+    lock->Release();
+}
+
+void
+BufferCache::ReadAhead(int sector)
+{
+    if (maxReadAhead == 0)
+        return;
+
+    lock->Acquire();
+    bool queued = false;
+    for (unsigned i = 0; i < numPending && !queued; i++)
+        queued = pending[(pendingHead + i) % pendingCapacity] == sector;
+    if (!queued && numPending < pendingCapacity
+          && Lookup(sector) == nullptr) {
+        pending[(pendingHead + numPending++) % pendingCapacity] = sector;
+        if (!readAheadRunning) {
+            readAheadRunning = true;
+            Thread *t = new Thread("read ahead");
+            t->Fork(ReadAheadThread, this);
+        }
+    }
+    lock->Release();
+}
+
+unsigned
+BufferCache::MaxReadAhead() const
+{
+    return maxReadAhead;
+}
+
+CacheBuffer *
+BufferCache::Lookup(int sector) const
+{
+    CacheBuffer *buffer = hashTable[sector & hashMask];
+    while (buffer != nullptr && buffer->sector != sector)
+        buffer = buffer->hashNext;
+    return buffer;
+}
+
+/// The buffer may be replaced while waiting, so it is looked up again.
+CacheBuffer *
+BufferCache::Find(int sector)
+{
+    CacheBuffer *buffer;
+    while ((buffer = Lookup(sector)) != nullptr && buffer->busy)
+        ioDone->Wait();
+    return buffer;
+}
+
+/// Returns null, instead, if the lock had to be released, to wait for a
+/// buffer or to write a modified one back: the sector may have been cached
+/// by some other thread meanwhile, so the caller must look it up again.
+CacheBuffer *
+BufferCache::Allocate(int sector)
+{
+    CacheBuffer *buffer = Victim();
+    if (buffer == nullptr) {
+        ioDone->Wait();
+        return nullptr;
+    }
+    if (buffer->dirty) {
+        WriteBack(buffer);
+        return nullptr;
+    }
+
+    if (buffer->sector < 0)
+        freeBuffers.Remove(buffer);
+    else {
+        DEBUG('f', "Replacing sector %d in the buffer cache\n",
+              buffer->sector);
+        Unhash(buffer);
+        if (buffer->hot)
+            frequent.Remove(buffer);
+        else {
+            recent.Remove(buffer);
+            numRecent--;
+            if (policy == CACHE_2Q)
+                AddGhost(buffer->sector);
+        }
+    }
+
+    buffer->sector    = sector;
+    buffer->valid     = false;
+    buffer->busy      = true;
+    buffer->hot       = policy == CACHE_2Q && IsGhost(sector);
+    buffer->readAhead = false;
+    if (buffer->hot)
+        frequent.Append(buffer);
+    else {
+        recent.Append(buffer);
+        numRecent++;
+    }
+    Hash(buffer);
+    return buffer;
+}
+
+/// Under 2Q, the FIFO queue gives up a sector while it is over its size,
+/// and the LRU queue otherwise.
+CacheBuffer *
+BufferCache::Victim() const
+{
+    if (!freeBuffers.IsEmpty())
+        return freeBuffers.Head();
+
+    const BufferQueue *first  = &recent;
+    const BufferQueue *second = &frequent;
+    if (policy == CACHE_2Q && numRecent <= recentLimit) {
+        first  = &frequent;
+        second = &recent;
+    }
+    for (CacheBuffer *b = first->Head(); b != nullptr; b = first->Next(b))
+        if (!b->busy)
+            return b;
+    for (CacheBuffer *b = second->Head(); b != nullptr; b = second->Next(b))
+        if (!b->busy)
+            return b;
+    return nullptr;
+}
+
+void
+BufferCache::Fill(CacheBuffer *buffer)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(buffer->busy && !buffer->valid);
+
+    lock->Release();
+    disk->ReadSector(buffer->sector, buffer->data);
+    lock->Acquire();
+    buffer->valid = true;
+    buffer->busy  = false;
+    ioDone->Broadcast();
+}
+
+void
+BufferCache::WriteBack(CacheBuffer *buffer)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(buffer->dirty && !buffer->busy);
+
+    buffer->busy = true;
+    lock->Release();
+    disk->WriteSector(buffer->sector, buffer->data);
+    lock->Acquire();
+    buffer->dirty = false;
+    buffer->busy  = false;
+    numDirty--;
+    stats->numCacheWriteBacks++;
+    ioDone->Broadcast();
+}
+
+CacheBuffer *
+BufferCache::OldestDirty() const
+{
+    CacheBuffer *oldest = nullptr;
+    for (unsigned i = 0; i < numBuffers; i++) {
+        CacheBuffer *b = &buffers[i];
+        if (b->dirty && !b->busy
+              && (oldest == nullptr || b->dirtySince < oldest->dirtySince))
+            oldest = b;
+    }
+    return oldest;
+}
+
+/// Under 2Q, a use does not move a sector within the FIFO queue.
+void
+BufferCache::Touch(CacheBuffer *buffer)
+{
+    ASSERT(buffer != nullptr);
+
+    if (buffer->hot) {
+        frequent.Remove(buffer);
+        frequent.Append(buffer);
+    } else if (policy == CACHE_LRU) {
+        recent.Remove(buffer);
+        recent.Append(buffer);
+    }
+}
+
+void
+BufferCache::Hash(CacheBuffer *buffer)
+{
+    CacheBuffer **chain = &hashTable[buffer->sector & hashMask];
+    buffer->hashNext = *chain;
+    *chain = buffer;
+}
+
+void
+BufferCache::Unhash(CacheBuffer *buffer)
+{
+    CacheBuffer **link = &hashTable[buffer->sector & hashMask];
+    while (*link != buffer) {
+        ASSERT(*link != nullptr);
+        link = &(*link)->hashNext;
+    }
+    *link = buffer->hashNext;
+    buffer->hashNext = nullptr;
+}
+
+/// There are only a few ghosts, so they are searched linearly; a miss
+/// costs a disk request anyway.
+bool
+BufferCache::IsGhost(int sector) const
+{
+    for (unsigned i = 0; i < numGhosts; i++)
+        if (ghosts[(ghostHead + i) % ghostCapacity] == sector)
+            return true;
+    return false;
+}
+
+/// The oldest ghost is forgotten when the ring is full.
+void
+BufferCache::AddGhost(int sector)
+{
+    if (numGhosts < ghostCapacity)
+        ghosts[(ghostHead + numGhosts++) % ghostCapacity] = sector;
+    else {
+        ghosts[ghostHead] = sector;
+        ghostHead = (ghostHead + 1) % ghostCapacity;
+    }
+}
+
+void
+BufferCache::ReadAheadThread(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((BufferCache *) arg)->ServeReadAheads();
+}
+
+/// Sectors read meanwhile by somebody else are skipped.  A reader that
+/// needs a sector being read ahead finds its buffer busy, and waits for it
+/// like for any other read.
+///
+/// The thread finishes once there is nothing left to read, rather than
+/// waiting for more, so that none is left blocked when Nachos halts.
+void
+BufferCache::ServeReadAheads()
+{
+    lock->Acquire();
+    while (numPending > 0) {
+        int sector = pending[pendingHead];
+        pendingHead = (pendingHead + 1) % pendingCapacity;
+        numPending--;
+
+        CacheBuffer *buffer = nullptr;
+        while (Lookup(sector) == nullptr
+                 && (buffer = Allocate(sector)) == nullptr);
+        if (buffer == nullptr)
+            continue;
+        DEBUG('f', "Reading sector %d ahead\n", sector);
+        stats->numReadAheads++;
+        Fill(buffer);
+        buffer->readAhead = true;
+    }
+    readAheadRunning = false;
+    lock->Release();
+}
+
+void
+BufferCache::WriteBehindThread(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((BufferCache *) arg)->WriteBehind();
+}
+
+/// Wakes up twice per `writeBehindAge`, so that no sector stays modified
+/// much longer than that.  Like the read-ahead thread, it finishes once
+/// there is nothing left to write.
+void
+BufferCache::WriteBehind()
+{
+    lock->Acquire();
+    while (numDirty > 0) {
+        lock->Release();
+        currentThread->SleepFor(writeBehindAge / 2 > 0 ? writeBehindAge / 2
+                                                       : 1);
+        lock->Acquire();
+
+        CacheBuffer *buffer;
+        while ((buffer = OldestDirty()) != nullptr
+                 && stats->totalTicks - buffer->dirtySince >= writeBehindAge) {
+            DEBUG('f', "Writing sector %d behind\n", buffer->sector);
+            WriteBack(buffer);
+        }
+    }
+    writeBehindRunning = false;
+    lock->Release();
+}
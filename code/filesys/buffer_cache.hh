@@ -0,0 +1,214 @@
+/// Data structures for caching disk sectors in memory.
+///
+/// The file system reads and writes whole sectors through the cache instead
+/// of going to the disk every time.  Sectors are found through a hash
+/// table; when the cache is full, a sector is chosen for replacement by
+/// one of two policies:
+///
+/// * LRU: the least recently used sector.
+/// * 2Q: sectors used once go to a FIFO queue, and only those used again
+///   after leaving it are promoted to an LRU queue, so that a single scan
+///   of a large file cannot flush the sectors in constant use (the
+///   directory and the free map, for instance).
+///
+/// Writes only change the cached copy, so that small writes to a sector
+/// are gathered into a single disk request.  Modified sectors are written
+/// back when replaced, when the cache is flushed, and by a kernel thread
+/// once they have been modified for a while.  A writer that finds too many
+/// sectors modified writes the oldest back itself.
+///
+/// Open files that are read sequentially ask for the sectors that follow to
+/// be read ahead.  A kernel thread reads them while the reader goes on, so
+/// that the disk is kept busy reading consecutive sectors, which mostly come
+/// from its track buffer.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_FILESYS_BUFFERCACHE__HH
+#define NACHOS_FILESYS_BUFFERCACHE__HH
+
+
+#include "synch_disk.hh"
+#include "lib/intrusive_list.hh"
+
+
+/// Replacement policies.
+enum CachePolicy {
+    CACHE_LRU,
+    CACHE_2Q,
+    NUM_CACHE_POLICIES
+};
+
+/// Parse a policy name (`lru` or `2q`); returns false if unknown.
+bool ParseCachePolicy(const char *name, CachePolicy *policy);
+
+/// Sectors cached unless told otherwise (see `threads/main.cc`).
+const unsigned DEFAULT_CACHE_SECTORS = 32;
+
+/// Largest read-ahead window, in sectors, unless told otherwise.
+const unsigned DEFAULT_READ_AHEAD = 8;
+
+/// Ticks a sector may stay modified, unless told otherwise; about two
+/// revolutions of the disk.
+const unsigned long DEFAULT_WRITE_BEHIND = 30000;
+
+/// A sector in the cache.
+class CacheBuffer {
+public:
+    int sector;  ///< Sector held, or -1 if free.
+    bool valid;  ///< `data` holds the contents of `sector`.
+    bool dirty;  ///< `data` is newer than the disk.
+    bool busy;   ///< Being read or written; must not be touched.
+    bool hot;    ///< Under 2Q, on the LRU queue rather than the FIFO one.
+    bool readAhead;  ///< Read ahead, and not used since.
+    unsigned long dirtySince;  ///< Time `dirty` was last set.
+
+    CacheBuffer *hashNext;
+    ListLink<CacheBuffer> queueLink;
+
+    char data[SECTOR_SIZE];
+};
+
+class BufferCache {
+public:
+
+    /// Initialize an empty cache of `numBuffers` sectors in front of
+    /// `disk`.  With no buffers, every request goes to the disk.
+    ///
+    /// Up to `maxReadAhead` sectors are read ahead of a sequential reader,
+    /// but never more than a quarter of the cache.  Sectors modified for
+    /// `writeBehind` ticks are written back in the background; if 0, only
+    /// when replaced or flushed.
+    BufferCache(SynchDisk *disk, unsigned numBuffers,
+                CachePolicy policy = CACHE_LRU, unsigned maxReadAhead = 0,
+                unsigned long writeBehind = 0);
+
+    /// De-allocate the cache.  It should have been flushed.
+    ~BufferCache();
+
+    /// Like the methods of `SynchDisk`, but going to the disk only if the
+    /// sector is not cached.
+    void ReadSector(int sector, char *data);
+    void WriteSector(int sector, const char *data);
+
+    /// Write `numBytes` bytes from `data` into `sector`, starting at
+    /// `offset` within it.  The rest of the sector is kept, so it is read
+    /// first if not cached.
+    void WriteBytes(int sector, const char *data,
+                    unsigned offset, unsigned numBytes);
+
+    /// Write every modified sector back to the disk.
+    void Flush();
+
+    /// Read `sector` into the cache in the background, unless it is
+    /// already cached.  The request is dropped if too many are pending.
+    void ReadAhead(int sector);
+
+    /// Largest number of sectors worth reading ahead; 0 if disabled.
+    unsigned MaxReadAhead() const;
+
+private:
+
+    /// Cached buffer for `sector`, or null.
+    CacheBuffer *Lookup(int sector) const;
+
+    /// Like `Lookup`, but wait until the buffer is not busy.
+    CacheBuffer *Find(int sector);
+
+    /// Take a buffer for `sector`, which is not cached, replacing another
+    /// sector if needed.  The buffer is returned busy and not valid.
+    CacheBuffer *Allocate(int sector);
+
+    /// Buffer to replace, or null if all are busy.
+    CacheBuffer *Victim() const;
+
+    /// Read the sector of a buffer just allocated; the lock is released
+    /// meanwhile.
+    void Fill(CacheBuffer *buffer);
+
+    /// Write `buffer` back; the lock is released meanwhile.
+    void WriteBack(CacheBuffer *buffer);
+
+    /// Modified buffer that has been so for the longest time, leaving out
+    /// busy ones; null if none.
+    CacheBuffer *OldestDirty() const;
+
+    /// Record a use of `buffer`, for the replacement policy.
+    void Touch(CacheBuffer *buffer);
+
+    void Hash(CacheBuffer *buffer);
+    void Unhash(CacheBuffer *buffer);
+
+    /// Under 2Q, sectors recently dropped from the FIFO queue.  They are
+    /// promoted if used again while remembered.
+    bool IsGhost(int sector) const;
+    void AddGhost(int sector);
+
+    /// Body of the read-ahead thread, which runs only while there are
+    /// sectors pending.
+    static void ReadAheadThread(void *arg);
+    void ServeReadAheads();
+
+    /// Body of the write-behind thread, which runs only while there are
+    /// modified sectors.
+    static void WriteBehindThread(void *arg);
+    void WriteBehind();
+
+    typedef IntrusiveList<CacheBuffer, &CacheBuffer::queueLink> BufferQueue;
+
+    SynchDisk *disk;
+    CachePolicy policy;
+
+    CacheBuffer *buffers;
+    unsigned numBuffers;
+
+    /// Chains of buffers by sector; the number of chains is a power of
+    /// two.
+    CacheBuffer **hashTable;
+    unsigned hashMask;
+
+    /// Buffers holding no sector.
+    BufferQueue freeBuffers;
+
+    /// Under LRU, every buffer in use, least recently used first.  Under
+    /// 2Q, the FIFO queue of sectors used once, and the LRU queue.
+    BufferQueue recent;
+    BufferQueue frequent;
+    unsigned numRecent;
+
+    /// Under 2Q, the size `recent` is kept to.
+    unsigned recentLimit;
+
+    /// Ring of remembered sectors, for 2Q.
+    int *ghosts;
+    unsigned ghostCapacity;
+    unsigned ghostHead;
+    unsigned numGhosts;
+
+    /// Ring of sectors waiting to be read ahead.
+    unsigned maxReadAhead;
+    int *pending;
+    unsigned pendingCapacity;
+    unsigned pendingHead;
+    unsigned numPending;
+    bool readAheadRunning;
+
+    /// Modified buffers, how many are too many, and how long they may stay
+    /// modified.
+    unsigned numDirty;
+    unsigned dirtyLimit;
+    unsigned long writeBehindAge;
+    bool writeBehindRunning;
+
+    /// Protects all of the above.  It is not held during disk requests;
+    /// buffers are marked busy instead.
+    Lock *lock;
+
+    /// Signalled when a buffer stops being busy.
+    Condition *ioDone;
+};
+
+
+#endif
@@ -74,7 +74,7 @@ FileHeader::Deallocate(Bitmap *freeMap)
 void
 FileHeader::FetchFrom(unsigned sector)
 {
-    synchDisk->ReadSector(sector, (char *) &raw);
+    bufferCache->ReadSector(sector, (char *) &raw);
 }
 
 /// Write the modified contents of the file header back to disk.
@@ -83,7 +83,7 @@ FileHeader::FetchFrom(unsigned sector)
 void
 FileHeader::WriteBack(unsigned sector)
 {
-    synchDisk->WriteSector(sector, (char *) &raw);
+    bufferCache->WriteSector(sector, (char *) &raw);
 }
 
 /// Return which disk sector is storing a particular byte within the file.
@@ -127,7 +127,7 @@ FileHeader::Print(const char *title)
 
     for (unsigned i = 0, k = 0; i < raw.numSectors; i++) {
         printf("    contents of block %u:\n", raw.dataSectors[i]);
-        synchDisk->ReadSector(raw.dataSectors[i], data);
+        bufferCache->ReadSector(raw.dataSectors[i], data);
         for (unsigned j = 0; j < SECTOR_SIZE && k < raw.numBytes; j++, k++) {
             if (isprint(data[j]))
                 printf("%c", data[j]);
@@ -26,7 +26,10 @@ OpenFile::OpenFile(int sector)
 {
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
-    seekPosition = 0;
+    seekPosition    = 0;
+    nextSector      = 0;
+    readAheadWindow = 0;
+    readAheadEnd    = 0;
 }
 
 /// Close a Nachos file, de-allocating any in-memory data structures.
@@ -93,10 +96,9 @@ OpenFile::Write(const char *into, unsigned numBytes)
 ///     We read in all of the full or partial sectors that are part of the
 ///     request, but we only copy the part we are interested in.
 /// For WriteAt:
-///     We must first read in any sectors that will be partially written, so
-///     that we do not overwrite the unmodified portion.  We then copy in the
-///     data that will be modified, and write back all the full or partial
-///     sectors that are part of the request.
+///     We hand each full or partial sector to the buffer cache, which
+///     modifies its cached copy in place (reading it in first if a partial
+///     sector is not cached), and writes it back to the disk later on.
 ///
 /// * `into` is the buffer to contain the data to be read from disk.
 /// * `from` is the buffer containing the data to be written to disk.
@@ -125,11 +127,13 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
     lastSector = DivRoundDown(position + numBytes - 1, SECTOR_SIZE);
     numSectors = 1 + lastSector - firstSector;
 
+    ReadAhead(firstSector, lastSector);
+
     // Read in all the full and partial sectors that we need.
     buf = new char [numSectors * SECTOR_SIZE];
     for (unsigned i = firstSector; i <= lastSector; i++)
-        synchDisk->ReadSector(hdr->ByteToSector(i * SECTOR_SIZE),
-                              &buf[(i - firstSector) * SECTOR_SIZE]);
+        bufferCache->ReadSector(hdr->ByteToSector(i * SECTOR_SIZE),
+                                &buf[(i - firstSector) * SECTOR_SIZE]);
 
     // Copy the part we want.
     memcpy(into, &buf[position - firstSector * SECTOR_SIZE], numBytes);
@@ -144,9 +148,7 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
     ASSERT(numBytes > 0);
 
     unsigned fileLength = hdr->FileLength();
-    unsigned firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    unsigned firstSector, lastSector;
 
     if (position >= fileLength)
         return 0;  // Check request.
@@ -157,31 +159,57 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
 
     firstSector = DivRoundDown(position, SECTOR_SIZE);
     lastSector  = DivRoundDown(position + numBytes - 1, SECTOR_SIZE);
-    numSectors  = 1 + lastSector - firstSector;
-
-    buf = new char [numSectors * SECTOR_SIZE];
-
-    firstAligned = position == firstSector * SECTOR_SIZE;
-    lastAligned  = position + numBytes == (lastSector + 1) * SECTOR_SIZE;
-
-    // Read in first and last sector, if they are to be partially modified.
-    if (!firstAligned)
-        ReadAt(buf, SECTOR_SIZE, firstSector * SECTOR_SIZE);
-    if (!lastAligned && (firstSector != lastSector || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SECTOR_SIZE],
-               SECTOR_SIZE, lastSector * SECTOR_SIZE);
 
-    // Copy in the bytes we want to change.
-    memcpy(&buf[position - firstSector * SECTOR_SIZE], from, numBytes);
-
-    // Write modified sectors back.
-    for (unsigned i = firstSector; i <= lastSector; i++)
-        synchDisk->WriteSector(hdr->ByteToSector(i * SECTOR_SIZE),
-                               &buf[(i - firstSector) * SECTOR_SIZE]);
-    delete [] buf;
+    // Copy in the bytes we want to change, sector by sector.
+    for (unsigned i = firstSector; i <= lastSector; i++) {
+        unsigned start = i * SECTOR_SIZE;
+        unsigned end   = start + SECTOR_SIZE;
+        if (start < position)
+            start = position;
+        if (end > position + numBytes)
+            end = position + numBytes;
+        bufferCache->WriteBytes(hdr->ByteToSector(i * SECTOR_SIZE),
+                                &from[start - position],
+                                start - i * SECTOR_SIZE, end - start);
+    }
     return numBytes;
 }
 
+/// A read is sequential if it starts in the last sector read, or in the one
+/// after it, so that small reads within a sector do not break a sequence.
+/// Sectors are asked for ahead of time even if cached; the cache ignores
+/// those.
+void
+OpenFile::ReadAhead(unsigned firstSector, unsigned lastSector)
+{
+    unsigned maxWindow = bufferCache->MaxReadAhead();
+    bool sequential = firstSector == nextSector
+                      || firstSector + 1 == nextSector;
+    bool movedOn = lastSector + 1 > nextSector;
+
+    if (!sequential) {
+        readAheadWindow = 0;
+        readAheadEnd    = 0;
+    } else if (movedOn && maxWindow > 0) {
+        readAheadWindow = readAheadWindow == 0 ? 2 : 2 * readAheadWindow;
+        if (readAheadWindow > maxWindow)
+            readAheadWindow = maxWindow;
+    }
+    nextSector = lastSector + 1;
+    if (readAheadWindow == 0)
+        return;
+
+    unsigned fileSectors = DivRoundUp(hdr->FileLength(), SECTOR_SIZE);
+    unsigned first = readAheadEnd > nextSector ? readAheadEnd : nextSector;
+    unsigned end   = nextSector + readAheadWindow;
+    if (end > fileSectors)
+        end = fileSectors;
+    for (unsigned i = first; i < end; i++)
+        bufferCache->ReadAhead(hdr->ByteToSector(i * SECTOR_SIZE));
+    if (end > readAheadEnd)
+        readAheadEnd = end;
+}
+
 /// Return the number of bytes in the file.
 unsigned
 OpenFile::Length() const
@@ -115,8 +115,25 @@ public:
     unsigned Length() const;
 
   private:
+
+    /// Ask the buffer cache to read ahead if the file is being read
+    /// sequentially; `firstSector` and `lastSector` are the sectors (of the
+    /// file) just read.
+    void ReadAhead(unsigned firstSector, unsigned lastSector);
+
     FileHeader *hdr;  ///< Header for this file.
     unsigned seekPosition;  ///< Current position within the file.
+
+    /// Last sector of the file read, plus one, or 0 if none.
+    unsigned nextSector;
+
+    /// Sectors to keep read ahead of a sequential reader.  It starts
+    /// small, doubles every time the reader moves on to a new sector, and
+    /// drops to 0 when the reader jumps elsewhere.
+    unsigned readAheadWindow;
+
+    /// Sector after the last one already asked to be read ahead.
+    unsigned readAheadEnd;
 };
 
 #endif
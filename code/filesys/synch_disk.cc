@@ -14,6 +14,7 @@
 
 
 #include "synch_disk.hh"
+#include "threads/system.hh"
 
 
 /// Disk interrupt handler.  Need this to be a C routine, because C++ cannot
@@ -34,14 +35,18 @@ DiskRequestDone(void *arg)
 SynchDisk::SynchDisk(const char *name)
 {
     semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    // The holder sleeps through the whole request, so spinning for the
+    // lock is useless, and a barging requester could starve the others.
+    lock = new Lock("synch disk lock", LOCK_PRIORITY_HANDOFF);
     disk = new Disk(name, DiskRequestDone, this);
+    wakeUp = new DeferredWork(WakeRequester, this);
 }
 
 /// De-allocate data structures needed for the synchronous disk abstraction.
 SynchDisk::~SynchDisk()
 {
     delete disk;
+    delete wakeUp;
     delete lock;
     delete semaphore;
 }
@@ -57,6 +62,7 @@ SynchDisk::ReadSector(int sectorNumber, char *data)
     ASSERT(data != nullptr);
 
     lock->Acquire();  // Only one disk I/O at a time.
+    currentThread->usage.diskReads++;
     disk->ReadRequest(sectorNumber, data);
     semaphore->P();   // Wait for interrupt.
     lock->Release();
@@ -73,15 +79,27 @@ SynchDisk::WriteSector(int sectorNumber, const char *data)
     ASSERT(data != nullptr);
 
     lock->Acquire();  // only one disk I/O at a time
+    currentThread->usage.diskWrites++;
     disk->WriteRequest(sectorNumber, data);
     semaphore->P();   // wait for interrupt
     lock->Release();
 }
 
 /// Disk interrupt handler.  Wake up any thread waiting for the disk
-/// request to finish.
+/// request to finish, once interrupts are enabled again.
+///
+/// There is a single request at a time, so the wake up is never deferred
+/// while still queued.
 void
 SynchDisk::RequestDone()
 {
-    semaphore->V();
+    interrupt->Defer(wakeUp);
+}
+
+void
+SynchDisk::WakeRequester(void *arg)
+{
+    ASSERT(arg != nullptr);
+    SynchDisk *disk = (SynchDisk *) arg;
+    disk->semaphore->V();
 }
@@ -10,6 +10,7 @@
 
 
 #include "machine/disk.hh"
+#include "machine/interrupt.hh"
 #include "threads/synch.hh"
 
 
@@ -44,7 +45,12 @@ public:
     void RequestDone();
 
 private:
+
+    /// Wake up the requesting thread, once interrupts are enabled.
+    static void WakeRequester(void *arg);
+
     Disk *disk;  ///< Raw disk device.
+    DeferredWork *wakeUp;  ///< Deferred by `RequestDone`.
     Semaphore *semaphore;  ///< To synchronize requesting thread with the
                            ///< interrupt handler.
     Lock *lock;  ///< Only one read/write request can be sent to the disk at
@@ -0,0 +1,122 @@
+/// Routines to manage logarithmic histograms.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "histogram.hh"
+#include "utility.hh"
+
+#include <limits.h>
+
+
+Histogram::Histogram()
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++)
+        buckets[i] = 0;
+    count = sum = max = 0;
+}
+
+void
+Histogram::Record(unsigned long value)
+{
+    unsigned i = 0;
+    if (value != 0)
+        i = sizeof value * 8 - __builtin_clzl(value);
+    if (i >= NUM_BUCKETS)
+        i = NUM_BUCKETS - 1;
+
+    buckets[i]++;
+    count++;
+    sum += value;
+    if (value > max)
+        max = value;
+}
+
+void
+Histogram::Merge(const Histogram &other)
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++)
+        buckets[i] += other.buckets[i];
+    count += other.count;
+    sum   += other.sum;
+    if (other.max > max)
+        max = other.max;
+}
+
+unsigned long
+Histogram::Count() const
+{
+    return count;
+}
+
+unsigned long
+Histogram::Sum() const
+{
+    return sum;
+}
+
+unsigned long
+Histogram::Max() const
+{
+    return max;
+}
+
+unsigned long
+Histogram::BucketLimit(unsigned i)
+{
+    ASSERT(i < NUM_BUCKETS);
+
+    if (i == NUM_BUCKETS - 1)
+        return ULONG_MAX;
+    return i == 0 ? 0 : (1UL << i) - 1;
+}
+
+/// The bound is clipped to the maximum, which is known exactly.
+unsigned long
+Histogram::Percentile(unsigned percent) const
+{
+    ASSERT(percent <= 100);
+
+    if (count == 0)
+        return 0;
+
+    // Rank of the sample, counting from 1.
+    unsigned long rank = (count * percent + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+
+    unsigned long seen = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return BucketLimit(i) < max ? BucketLimit(i) : max;
+    }
+    return max;
+}
+
+void
+Histogram::Print(const char *label) const
+{
+    ASSERT(label != nullptr);
+
+    printf("%s: n %lu, mean %lu, p50 %lu, p90 %lu, p99 %lu, max %lu\n",
+           label, count, count != 0 ? sum / count : 0, Percentile(50),
+           Percentile(90), Percentile(99), max);
+}
+
+void
+Histogram::Write(FILE *file) const
+{
+    ASSERT(file != nullptr);
+
+    unsigned last = NUM_BUCKETS;
+    while (last > 0 && buckets[last - 1] == 0)
+        last--;
+
+    fprintf(file, "%lu\t%lu\t%lu", count, sum, max);
+    for (unsigned i = 0; i < last; i++)
+        fprintf(file, "\t%lu", buckets[i]);
+    fprintf(file, "\n");
+}
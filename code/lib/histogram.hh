@@ -0,0 +1,60 @@
+/// A histogram with logarithmic buckets, for distributions of times.
+///
+/// Bucket 0 counts zeros and bucket `i > 0` counts values in
+/// `[2^(i-1), 2^i)`, so recording a value costs a few instructions and the
+/// histogram has a fixed, small size whatever the range of the values.
+/// Percentiles are only known up to a power of two.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_HISTOGRAM__HH
+#define NACHOS_LIB_HISTOGRAM__HH
+
+
+#include <stdio.h>
+
+
+class Histogram {
+public:
+
+    /// Values of `2^(NUM_BUCKETS - 2)` and up all go to the last bucket.
+    static const unsigned NUM_BUCKETS = 33;
+
+    /// Initialize an empty histogram.
+    Histogram();
+
+    /// Add one sample.
+    void Record(unsigned long value);
+
+    /// Add all the samples of `other`.
+    void Merge(const Histogram &other);
+
+    unsigned long Count() const;
+    unsigned long Sum() const;
+    unsigned long Max() const;
+
+    /// Upper bound of the bucket holding the `percent`th percentile.
+    unsigned long Percentile(unsigned percent) const;
+
+    /// Print a one line summary, preceded by `label`.
+    void Print(const char *label) const;
+
+    /// Write the samples as tab separated fields: count, sum, maximum, and
+    /// the bucket counts up to the last non-empty one.
+    void Write(FILE *file) const;
+
+    /// Largest value counted in bucket `i`.
+    static unsigned long BucketLimit(unsigned i);
+
+private:
+
+    unsigned long buckets[NUM_BUCKETS];
+    unsigned long count;
+    unsigned long sum;
+    unsigned long max;
+};
+
+
+#endif
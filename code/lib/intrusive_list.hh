@@ -0,0 +1,227 @@
+/// Doubly linked lists whose links are embedded in the items themselves.
+///
+/// Unlike `List`, inserting an item does not allocate anything, and an item
+/// can be removed from the middle of its list in constant time.  The price
+/// is that an item can be on at most one list per embedded link.
+///
+/// Usage: give the item class a public `ListLink<Item>` member, and
+/// instantiate the list with a pointer to it:
+///
+///     class Thread { ... ListLink<Thread> queueLink; ... };
+///     IntrusiveList<Thread, &Thread::queueLink> queue;
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_INTRUSIVELIST__HH
+#define NACHOS_LIB_INTRUSIVELIST__HH
+
+
+#include "utility.hh"
+
+
+/// Link to be embedded in items of an `IntrusiveList`.
+template <class Item>
+class ListLink {
+public:
+    ListLink()
+    {
+        prev = next = nullptr;
+        linked = false;
+    }
+
+    /// Is the item currently on some list through this link?
+    bool IsLinked() const
+    {
+        return linked;
+    }
+
+private:
+    template <class T, ListLink<T> T::*link>
+    friend class IntrusiveList;
+
+    Item *prev;
+    Item *next;
+    bool linked;
+};
+
+
+template <class Item, ListLink<Item> Item::*link>
+class IntrusiveList {
+public:
+
+    /// Initialize the list.
+    IntrusiveList();
+
+    /// Put item at the beginning of the list.
+    void Prepend(Item *item);
+
+    /// Put item at the end of the list.
+    void Append(Item *item);
+
+    /// Put `item` just before `next`, which must be on this list, or at the
+    /// end if `next` is null.
+    void InsertBefore(Item *item, Item *next);
+
+    /// Take item off the front of the list.
+    ///
+    /// Returns null if the list is empty.
+    Item *Pop();
+
+    /// Take `item` off the list; it must be on this list.
+    void Remove(Item *item);
+
+    /// Apply `func` to all elements in list.
+    void Apply(void (*func)(Item *)) const;
+
+    /// Is the list empty?
+    bool IsEmpty() const;
+
+    /// Returns the head of the list, or null if it is empty.
+    Item *Head() const;
+
+    /// Returns the item after `item`, or null if it is the last one.
+    Item *Next(const Item *item) const;
+
+private:
+    Item *first;  ///< Head of the list, null if list is empty.
+    Item *last;   ///< Last element of list.
+};
+
+
+template <class Item, ListLink<Item> Item::*link>
+IntrusiveList<Item, link>::IntrusiveList()
+{
+    first = last = nullptr;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+void
+IntrusiveList<Item, link>::Prepend(Item *item)
+{
+    ASSERT(item != nullptr);
+    ListLink<Item> &l = item->*link;
+    ASSERT(!l.linked);
+
+    l.linked = true;
+    l.prev = nullptr;
+    l.next = first;
+    if (first == nullptr)
+        last = item;
+    else
+        (first->*link).prev = item;
+    first = item;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+void
+IntrusiveList<Item, link>::Append(Item *item)
+{
+    ASSERT(item != nullptr);
+    ListLink<Item> &l = item->*link;
+    ASSERT(!l.linked);
+
+    l.linked = true;
+    l.prev = last;
+    l.next = nullptr;
+    if (last == nullptr)
+        first = item;
+    else
+        (last->*link).next = item;
+    last = item;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+void
+IntrusiveList<Item, link>::InsertBefore(Item *item, Item *next)
+{
+    if (next == nullptr) {
+        Append(item);
+        return;
+    }
+    if (next == first) {
+        Prepend(item);
+        return;
+    }
+
+    ASSERT(item != nullptr);
+    ListLink<Item> &l = item->*link;
+    ListLink<Item> &n = next->*link;
+    ASSERT(!l.linked);
+    ASSERT(n.linked);
+
+    l.linked = true;
+    l.prev = n.prev;
+    l.next = next;
+    (n.prev->*link).next = item;
+    n.prev = item;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+Item *
+IntrusiveList<Item, link>::Pop()
+{
+    Item *item = first;
+    if (item != nullptr)
+        Remove(item);
+    return item;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+void
+IntrusiveList<Item, link>::Remove(Item *item)
+{
+    ASSERT(item != nullptr);
+    ListLink<Item> &l = item->*link;
+    ASSERT(l.linked);
+
+    if (l.prev == nullptr)
+        first = l.next;
+    else
+        (l.prev->*link).next = l.next;
+    if (l.next == nullptr)
+        last = l.prev;
+    else
+        (l.next->*link).prev = l.prev;
+
+    l.prev = l.next = nullptr;
+    l.linked = false;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+void
+IntrusiveList<Item, link>::Apply(void (*func)(Item *)) const
+{
+    ASSERT(func != nullptr);
+
+    for (Item *item = first; item != nullptr; item = (item->*link).next)
+        func(item);
+}
+
+template <class Item, ListLink<Item> Item::*link>
+bool
+IntrusiveList<Item, link>::IsEmpty() const
+{
+    return first == nullptr;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+Item *
+IntrusiveList<Item, link>::Head() const
+{
+    return first;
+}
+
+template <class Item, ListLink<Item> Item::*link>
+Item *
+IntrusiveList<Item, link>::Next(const Item *item) const
+{
+    ASSERT(item != nullptr);
+    ASSERT((item->*link).linked);
+
+    return (item->*link).next;
+}
+
+
+#endif
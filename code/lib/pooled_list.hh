@@ -0,0 +1,283 @@
+/// Lists that recycle their elements.
+///
+/// `PooledList` has the same interface as `List`, but list elements are
+/// carved out of blocks owned by the list and kept on a free list when
+/// items are removed.  The blocks are released with the list.
+///
+/// The pool is not of a fixed capacity: when it runs out, it grows by a
+/// block twice as large as the previous one, and it never shrinks.  Its
+/// users (pending interrupts, `SynchList`, channel buffers) have no bound
+/// on their length, and `List` offers no way to report a full list, so a
+/// fixed pool would have to fail an `Append` that callers cannot handle.
+/// Growing only happens when a list reaches a length it never had before;
+/// from then on, it does no further heap allocation.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_POOLEDLIST__HH
+#define NACHOS_LIB_POOLEDLIST__HH
+
+
+#include "utility.hh"
+
+
+template <class Item>
+class PooledList {
+public:
+
+    /// Initialize the list, with room for `initialCapacity` items before
+    /// the pool has to grow.
+    PooledList(unsigned initialCapacity = 8);
+
+    /// De-allocate the list and its pool.
+    ~PooledList();
+
+    /// Put item at the beginning of the list.
+    void Prepend(Item item);
+
+    /// Put item at the end of the list.
+    void Append(Item item);
+
+    /// Take item off the front of the list.
+    Item Pop();
+
+    /// Remove the first occurrence of `item`, if any.
+    void Remove(Item item);
+
+    /// Apply `func` to all elements in list.
+    void Apply(void (*func)(Item));
+
+    /// Does the list have some item?
+    bool Has(Item item) const;
+
+    /// Is the list empty?
+    bool IsEmpty() const;
+
+    /// Routines to put/get items on/off list in order (sorted by key).
+
+    /// Put item into list.
+    void SortedInsert(Item item, int sortKey);
+
+    /// Remove first item from list.
+    Item SortedPop(int *keyPtr);
+
+    /// Returns the head of the list.
+    Item Head();
+
+private:
+
+    struct Node {
+        Node *next;
+        int key;
+        Item item;
+    };
+
+    /// Take a node from the pool, growing it if needed.
+    Node *NewNode(Item item, int sortKey);
+
+    /// Give a node back to the pool.
+    void FreeNode(Node *node);
+
+    Node *first;  ///< Head of the list, null if list is empty.
+    Node *last;   ///< Last element of list.
+
+    Node *freeNodes;  ///< Nodes ready for reuse.
+
+    /// Blocks allocated for the pool.  The first node of every block is not
+    /// used for items: its `next` links to the previous block.
+    Node *blocks;
+
+    /// Number of nodes in the next block to be allocated.
+    unsigned nextBlockSize;
+};
+
+
+template <class Item>
+PooledList<Item>::PooledList(unsigned initialCapacity)
+{
+    first = last = nullptr;
+    freeNodes = nullptr;
+    blocks = nullptr;
+    nextBlockSize = initialCapacity > 0 ? initialCapacity : 1;
+}
+
+template <class Item>
+PooledList<Item>::~PooledList()
+{
+    while (blocks != nullptr) {
+        Node *block = blocks;
+        blocks = block->next;
+        delete [] block;
+    }
+}
+
+template <class Item>
+typename PooledList<Item>::Node *
+PooledList<Item>::NewNode(Item item, int sortKey)
+{
+    if (freeNodes == nullptr) {
+        Node *block = new Node [nextBlockSize + 1];
+        block->next = blocks;
+        blocks = block;
+        for (unsigned i = 1; i <= nextBlockSize; i++)
+            FreeNode(&block[i]);
+        nextBlockSize *= 2;
+    }
+
+    Node *node = freeNodes;
+    freeNodes = node->next;
+    node->next = nullptr;
+    node->key  = sortKey;
+    node->item = item;
+    return node;
+}
+
+template <class Item>
+void
+PooledList<Item>::FreeNode(Node *node)
+{
+    node->item = Item();
+    node->next = freeNodes;
+    freeNodes = node;
+}
+
+template <class Item>
+void
+PooledList<Item>::Append(Item item)
+{
+    Node *element = NewNode(item, 0);
+
+    if (IsEmpty())
+        first = element;
+    else
+        last->next = element;
+    last = element;
+}
+
+template <class Item>
+void
+PooledList<Item>::Prepend(Item item)
+{
+    Node *element = NewNode(item, 0);
+
+    if (IsEmpty())
+        last = element;
+    else
+        element->next = first;
+    first = element;
+}
+
+/// Returns `Item()` if nothing is on the list.
+template <class Item>
+Item
+PooledList<Item>::Pop()
+{
+    return SortedPop(nullptr);
+}
+
+template <class Item>
+void
+PooledList<Item>::Remove(Item item)
+{
+    for (Node *ptr = first, *prev = nullptr;
+         ptr != nullptr;
+         prev = ptr, ptr = ptr->next) {
+        if (item == ptr->item) {
+            if (prev != nullptr)
+                prev->next = ptr->next;
+            if (first == ptr)
+                first = ptr->next;
+            if (last == ptr)
+                last = prev;
+            FreeNode(ptr);
+            return;
+        }
+    }
+}
+
+template <class Item>
+void
+PooledList<Item>::Apply(void (*func)(Item))
+{
+    ASSERT(func != nullptr);
+
+    for (Node *ptr = first; ptr != nullptr; ptr = ptr->next)
+        func(ptr->item);
+}
+
+template <class Item>
+bool
+PooledList<Item>::Has(Item item) const
+{
+    for (Node *ptr = first; ptr != nullptr; ptr = ptr->next)
+        if (item == ptr->item)
+            return true;
+    return false;
+}
+
+template <class Item>
+bool
+PooledList<Item>::IsEmpty() const
+{
+    return first == nullptr;
+}
+
+/// Insert `item` after every element with a key not greater than
+/// `sortKey`, so that items with equal keys stay in FIFO order.
+template <class Item>
+void
+PooledList<Item>::SortedInsert(Item item, int sortKey)
+{
+    Node *element = NewNode(item, sortKey);
+
+    if (IsEmpty()) {
+        first = element;
+        last = element;
+    } else if (sortKey < first->key) {
+        element->next = first;
+        first = element;
+    } else {
+        for (Node *ptr = first; ptr->next != nullptr; ptr = ptr->next) {
+            if (sortKey < ptr->next->key) {
+                element->next = ptr->next;
+                ptr->next = element;
+                return;
+            }
+        }
+        last->next = element;
+        last = element;
+    }
+}
+
+/// Returns `Item()` if nothing is on the list; otherwise, if `keyPtr` is
+/// not null, sets `*keyPtr` to the key of the removed item.
+template <class Item>
+Item
+PooledList<Item>::SortedPop(int *keyPtr)
+{
+    if (IsEmpty())
+        return Item();
+
+    Node *element = first;
+    Item thing = element->item;
+    first = element->next;
+    if (first == nullptr)
+        last = nullptr;
+    if (keyPtr != nullptr)
+        *keyPtr = element->key;
+    FreeNode(element);
+    return thing;
+}
+
+template <class Item>
+Item
+PooledList<Item>::Head()
+{
+    ASSERT(!IsEmpty());
+    return first->item;
+}
+
+
+#endif
@@ -8,7 +8,7 @@
 #define NACHOS_LIB_TABLE__HH
 
 
-#include "list.hh"
+#include "pooled_list.hh"
 
 
 template <class T>
@@ -50,7 +50,7 @@ private:
     /// among those with greatest numbers, so it is not possible to modify
     /// `current`.  In other words, this keeps track of external
     /// fragmentation.
-    List<int> freed;
+    PooledList<int> freed;
 };
 
 
@@ -128,6 +128,10 @@ Disk::ReadRequest(unsigned sectorNumber, char *data)
     if (debug.IsEnabled('d'))
         PrintSector(false, sectorNumber, data);
 
+    if (traceLog != nullptr)
+        traceLog->Span(DISK_TRACK, "disk", "read", stats->totalTicks,
+                       stats->totalTicks + ticks, "sector", sectorNumber);
+
     active = true;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
@@ -150,6 +154,10 @@ Disk::WriteRequest(unsigned sectorNumber, const char *data)
     if (debug.IsEnabled('d'))
         PrintSector(true, sectorNumber, data);
 
+    if (traceLog != nullptr)
+        traceLog->Span(DISK_TRACK, "disk", "write", stats->totalTicks,
+                       stats->totalTicks + ticks, "sector", sectorNumber);
+
     active = true;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
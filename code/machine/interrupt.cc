@@ -25,6 +25,7 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <time.h>
 
 
 // String definitions for debugging messages
@@ -32,7 +33,7 @@
 static const char *INT_LEVEL_NAMES[] = { "disabled", "enabled" };
 static const char *INT_TYPE_NAMES[]  = {
     "timer", "disk", "console write", "console read",
-    "network send", "network recv"
+    "network send", "network recv", "timeout"
 };
 
 static inline bool
@@ -66,16 +67,40 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
     type    = kind;
 }
 
+/// Host time in nanoseconds, to measure how long handlers keep interrupts
+/// disabled; simulated time does not advance meanwhile.
+static unsigned long
+HostNanoseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+DeferredWork::DeferredWork(VoidFunctionPtr func, void *param)
+{
+    ASSERT(func != nullptr);
+
+    function   = func;
+    arg        = param;
+    next       = nullptr;
+    queued     = false;
+    deferredAt = 0;
+}
+
 /// Initialize the simulation of hardware device interrupts.
 ///
 /// Interrupts start disabled, with no interrupts pending, etc.
 Interrupt::Interrupt()
 {
     level         = INT_OFF;
-    pending       = new List<PendingInterrupt *>;
+    pending       = new PooledList<PendingInterrupt *>;
     inHandler     = false;
     yieldOnReturn = false;
     status        = SYSTEM_MODE;
+    deferredHead  = nullptr;
+    deferredTail  = nullptr;
+    inDeferred    = false;
 }
 
 /// De-allocate the data structures needed by the interrupt simulation.
@@ -162,6 +187,13 @@ Interrupt::OneTick()
     while (CheckIfDue(false))      // Check for pending interrupts.
         ;
     ChangeLevel(INT_OFF, INT_ON);  // Re-enable interrupts.
+    if (inDeferred)                // Leave the rest to the outer tick.
+        return;
+    if (deferredHead != nullptr) { // Finish the work of the handlers.
+        status = SYSTEM_MODE;
+        RunDeferred();
+        status = old;
+    }
     if (yieldOnReturn) {           // If the timer device handler asked for a
                                    // context switch, ok to do it now.
         yieldOnReturn = false;
@@ -184,6 +216,53 @@ Interrupt::YieldOnReturn()
     yieldOnReturn = true;
 }
 
+void
+Interrupt::Defer(DeferredWork *work)
+{
+    ASSERT(work != nullptr);
+    ASSERT(level == INT_OFF);
+
+    if (work->queued)
+        return;
+    work->queued     = true;
+    work->next       = nullptr;
+    work->deferredAt = stats->totalTicks;
+    if (deferredTail == nullptr)
+        deferredHead = work;
+    else
+        deferredTail->next = work;
+    deferredTail = work;
+}
+
+/// Work deferred meanwhile is run too, after the work already queued.
+void
+Interrupt::RunDeferred()
+{
+    ASSERT(!inDeferred);
+
+    inDeferred = true;
+    IntStatus oldLevel = level;
+    DeferredWork *work;
+    for (;;) {
+        ChangeLevel(level, INT_OFF);
+        work = deferredHead;
+        if (work == nullptr)
+            break;
+        deferredHead = work->next;
+        if (deferredHead == nullptr)
+            deferredTail = nullptr;
+        work->queued = false;
+        ChangeLevel(INT_OFF, oldLevel);
+
+        stats->deferredDelay.Record(stats->totalTicks - work->deferredAt);
+        unsigned long start = HostNanoseconds();
+        work->function(work->arg);
+        stats->deferredTime.Record(HostNanoseconds() - start);
+    }
+    ChangeLevel(INT_OFF, oldLevel);
+    inDeferred = false;
+}
+
 /// Routine called when there is nothing in the ready queue.
 ///
 /// Since something has to be running in order to put a thread on the ready
@@ -197,11 +276,17 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IDLE_MODE;
+    unsigned long start = stats->totalTicks;
     if (CheckIfDue(true)) {        // Check for any pending interrupts.
+        if (traceLog != nullptr)
+            traceLog->Span(CPU_TRACK, "sched", "idle",
+                           start, stats->totalTicks);
         while (CheckIfDue(false))  // Check for any other pending interrupts.
         yieldOnReturn = false;     // Since there is nothing in the ready
                                    // queue, the yield is automatic.
         status = SYSTEM_MODE;
+        RunDeferred();             // No thread to run it on; it may make
+                                   // one ready.
         return;                    // Return in case there is now a runnable
                                    // thread.
     }
@@ -222,7 +307,12 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    if (stats->histogramFile != nullptr)
+        currentThread->WriteHistograms(stats->histogramFile);
     stats->Print();
+    usageTable->Print();
+    if (synchProfile != nullptr)
+        synchProfile->Print();
     Cleanup();  // Never returns.
 }
 
@@ -236,8 +326,8 @@ Interrupt::Halt()
 void
 Interrupt::RestartTicks()
 {
-    List<PendingInterrupt *> *oldPending = pending;
-    pending = new List<PendingInterrupt *>;
+    PooledList<PendingInterrupt *> *oldPending = pending;
+    pending = new PooledList<PendingInterrupt *>;
 
     PendingInterrupt *i;
     unsigned          oldWhen = 0;
@@ -250,6 +340,8 @@ Interrupt::RestartTicks()
     }
 
     delete oldPending;
+    if (alarmClock != nullptr)
+        alarmClock->Rebase(stats->totalTicks);
     stats->totalTicks = 0;
     stats->tickResets += 1;
 }
@@ -268,7 +360,7 @@ Interrupt::RestartTicks()
 /// * `fromNow` is how far in the future (in simulated time) the interrupt is
 ///   to occur.
 /// * `type` is the hardware device that generated the interrupt.
-void
+PendingInterrupt *
 Interrupt::Schedule(VoidFunctionPtr handler, void *arg,
                     unsigned long fromNow, IntType type)
 {
@@ -295,6 +387,22 @@ Interrupt::Schedule(VoidFunctionPtr handler, void *arg,
           INT_TYPE_NAMES[type], when);
 
     pending->SortedInsert(toOccur, when);
+    return toOccur;
+}
+
+/// Used by timed waits that end before their timeout.  Interrupts must be
+/// disabled, so that the interrupt cannot occur meanwhile.
+void
+Interrupt::Cancel(PendingInterrupt *toCancel)
+{
+    ASSERT(toCancel != nullptr);
+    ASSERT(level == INT_OFF);
+
+    DEBUG('i', "Cancelling interrupt handler the %s at time = %lu\n",
+          INT_TYPE_NAMES[toCancel->type], toCancel->when);
+
+    pending->Remove(toCancel);
+    delete toCancel;
 }
 
 /// Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -344,7 +452,14 @@ Interrupt::CheckIfDue(bool advanceClock)
     inHandler = true;
     status = SYSTEM_MODE;  // Whatever we were doing, we are now going to be
                            // running in the kernel.
+    unsigned long start = stats->totalTicks;
+    unsigned long hostStart = HostNanoseconds();
     (*toOccur->handler)(toOccur->arg);  // Call the interrupt handler.
+    stats->handlerTime.Record(HostNanoseconds() - hostStart);
+    if (traceLog != nullptr)
+        traceLog->Span(INTERRUPT_TRACK, "interrupt",
+                       INT_TYPE_NAMES[toOccur->type],
+                       start, stats->totalTicks);
     status = old;  // Restore the machine status.
     inHandler = false;
     delete toOccur;
@@ -363,6 +478,12 @@ Interrupt::GetStatus() const
     return status;
 }
 
+bool
+Interrupt::InDeferred() const
+{
+    return inDeferred;
+}
+
 void
 Interrupt::SetStatus(MachineStatus st)
 {
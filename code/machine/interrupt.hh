@@ -36,7 +36,7 @@
 #define NACHOS_MACHINE_INTERRUPT__HH
 
 
-#include "lib/list.hh"
+#include "lib/pooled_list.hh"
 
 
 /// Interrupts can be disabled (`INT_OFF`) or enabled (`INT_ON`).
@@ -66,6 +66,7 @@ enum IntType {
     CONSOLE_READ_INT,
     NETWORK_SEND_INT,
     NETWORK_RECV_INT,
+    TIMEOUT_INT,  ///< Not a device: the end of a timed wait in the kernel.
     NUM_INT_TYPES
 };
 
@@ -89,6 +90,30 @@ public:
     IntType type;  ///< For debugging.
 };
 
+/// Work that an interrupt handler leaves for later, to be run once
+/// interrupts are enabled again (see `Interrupt::Defer`).
+///
+/// It is meant to be embedded in the device driver, and deferred again
+/// every time the device interrupts.  Deferring it while it is already
+/// queued does nothing, so the function must handle everything that
+/// happened since it last ran, not a single event.
+class DeferredWork {
+public:
+
+    /// Initialize work that calls `func` with `param`.
+    DeferredWork(VoidFunctionPtr func, void *param);
+
+    VoidFunctionPtr function;
+    void *arg;
+
+    /// Next work in the queue, if `queued`.
+    DeferredWork *next;
+    bool queued;
+
+    /// Time it was queued.
+    unsigned long deferredAt;
+};
+
 /// The following class defines the data structures for the simulation
 /// of hardware interrupts.
 ///
@@ -122,9 +147,20 @@ public:
     // Cause a context switch on return from an interrupt handler.
     void YieldOnReturn();
 
+    /// Called from an interrupt handler, to run `work` once interrupts are
+    /// enabled again, before any context switch the handler asked for.
+    ///
+    /// Work runs on the stack of whichever thread was interrupted, so it
+    /// must not block.  If the machine was idle, there is no such thread,
+    /// and it runs right after the handler, with interrupts disabled.
+    void Defer(DeferredWork *work);
+
     // Idle, kernel, user.
     MachineStatus GetStatus() const;
 
+    /// Is deferred work running?  Threads must not be switched then.
+    bool InDeferred() const;
+
     void SetStatus(MachineStatus st);
 
     // Print interrupt state.
@@ -138,17 +174,22 @@ public:
 
     /// Schedule an interrupt to occur at time ``when''.
     ///
-    /// This is called by the hardware device simulators.
-    void Schedule(VoidFunctionPtr handler, void *arg,
-                  unsigned long when, IntType type);
+    /// This is called by the hardware device simulators.  Returns a handle
+    /// that can be passed to `Cancel` until the interrupt occurs.
+    PendingInterrupt *Schedule(VoidFunctionPtr handler, void *arg,
+                               unsigned long when, IntType type);
+
+    /// Withdraw an interrupt that was scheduled but has not occurred yet.
+    void Cancel(PendingInterrupt *toCancel);
 
     /// Advance simulated time.
     void OneTick();
 
 private:
     IntStatus level;  ///< Are interrupts enabled or disabled?
-    List<PendingInterrupt *> *pending;  ///< The list of interrupts scheduled
-                                        ///< to occur in the future.
+    PooledList<PendingInterrupt *> *pending;  ///< The list of interrupts
+                                              ///< scheduled to occur in the
+                                              ///< future.
     bool inHandler;  ///< True if we are running an interrupt handler.
     bool yieldOnReturn;  ///< True if we are to context switch on return from
                          ///< the interrupt handler.
@@ -163,6 +204,18 @@ private:
     void ChangeLevel(IntStatus old,
                      IntStatus now);
 
+    /// Run deferred work until there is none left.
+    void RunDeferred();
+
+    /// Deferred work, in the order it was deferred.
+    DeferredWork *deferredHead;
+    DeferredWork *deferredTail;
+
+    /// True while running deferred work.  Work may enable interrupts (for
+    /// instance, by calling `Semaphore::V`); the nested ticks neither run
+    /// more work nor switch threads, the outer one does.
+    bool inDeferred;
+
 #ifdef DFS_TICKS_FIX
     /// Restart total ticks and the pending interrupt list.
     void RestartTicks();
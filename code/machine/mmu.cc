@@ -30,6 +30,7 @@
 
 #include "mmu.hh"
 #include "endianness.hh"
+#include "threads/system.hh"
 
 
 MMU::MMU()
@@ -47,6 +48,7 @@ MMU::MMU()
     tlb = nullptr;
     pageTable = nullptr;
 #endif
+    referenceLog = nullptr;
 }
 
 MMU::~MMU()
@@ -54,6 +56,7 @@ MMU::~MMU()
     delete [] mainMemory;
     if (tlb != nullptr)
         delete [] tlb;
+    delete referenceLog;
 }
 
 /// Read `size` (1, 2, or 4) bytes of virtual memory at `addr` into
@@ -244,6 +247,10 @@ MMU::Translate(unsigned virtAddr, unsigned *physAddr,
     if (writing)
         entry->dirty = true;
 
+    // Only references of the user program make up its reference string.
+    if (referenceLog != nullptr && interrupt->GetStatus() == USER_MODE)
+        referenceLog->Record(vpn, writing);
+
     *physAddr = pageFrame * PAGE_SIZE + offset;
     ASSERT(*physAddr >= 0 && *physAddr + size <= MEMORY_SIZE);
     DEBUG_CONT('a', "physical address 0x%X\n", *physAddr);
@@ -11,6 +11,7 @@
 
 #include "exception_type.hh"
 #include "disk.hh"
+#include "reference_log.hh"
 #include "translation_entry.hh"
 
 
@@ -76,6 +77,10 @@ public:
     TranslationEntry *pageTable;
     unsigned pageTableSize;
 
+    /// If not null, every successful translation made in user mode is
+    /// recorded here.  Owned by the MMU.
+    ReferenceLog *referenceLog;
+
 private:
 
     /// Retrieve a page entry either from a page table or the TLB.
@@ -0,0 +1,72 @@
+/// Routines for recording the page reference string of user programs.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "reference_log.hh"
+#include "lib/utility.hh"
+
+
+ReferenceLog::ReferenceLog(const char *fileName)
+{
+    ASSERT(fileName != nullptr);
+
+    file = fopen(fileName, "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot create reference log `%s`.\n", fileName);
+        ASSERT(false);
+    }
+    fwrite(&REF_LOG_MAGIC, sizeof REF_LOG_MAGIC, 1, file);
+
+    space = 0;
+    run.count = 0;
+    buffered = 0;
+}
+
+ReferenceLog::~ReferenceLog()
+{
+    EndRun();
+    fwrite(buffer, sizeof *buffer, buffered, file);
+    fclose(file);
+}
+
+void
+ReferenceLog::SetSpace(unsigned newSpace)
+{
+    space = newSpace;
+}
+
+/// Consecutive references to the same page are folded into a single
+/// record; instruction fetches make these runs long.
+void
+ReferenceLog::Record(unsigned vpn, bool writing)
+{
+    if (run.count != 0 && run.space == space
+          && (run.vpn & ~REF_LOG_WRITE) == vpn) {
+        run.count++;
+        if (writing)
+            run.vpn |= REF_LOG_WRITE;
+        return;
+    }
+
+    EndRun();
+    run.space = space;
+    run.vpn   = writing ? vpn | REF_LOG_WRITE : vpn;
+    run.count = 1;
+}
+
+void
+ReferenceLog::EndRun()
+{
+    if (run.count == 0)
+        return;
+
+    buffer[buffered++] = run;
+    run.count = 0;
+    if (buffered == BUFFER_SIZE) {
+        fwrite(buffer, sizeof *buffer, buffered, file);
+        buffered = 0;
+    }
+}
@@ -0,0 +1,70 @@
+/// Data structures for recording the page reference string of user
+/// programs.
+///
+/// When enabled, the MMU reports here every successful translation made
+/// while running user instructions; accesses of the kernel to user memory
+/// (to copy system call arguments, for instance) are left out.  The
+/// references are written to a host file as run-length encoded records, to
+/// be replayed offline by `bin/refsim` against several page replacement
+/// policies.
+///
+/// File format (host byte order): the 4-byte magic `REF_LOG_MAGIC`,
+/// followed by any number of `ReferenceRecord`s.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_REFERENCELOG__HH
+#define NACHOS_MACHINE_REFERENCELOG__HH
+
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+const uint32_t REF_LOG_MAGIC = 0x4E524546;  ///< “NREF”.
+
+/// Set in `ReferenceRecord::vpn` if any reference of the run was a write.
+const uint32_t REF_LOG_WRITE = 0x80000000;
+
+/// `count` consecutive references by address space `space` to virtual page
+/// `vpn`.
+struct ReferenceRecord {
+    uint32_t space;
+    uint32_t vpn;
+    uint32_t count;
+};
+
+
+class ReferenceLog {
+public:
+
+    /// Open `fileName` for writing; abort if it cannot be created.
+    ReferenceLog(const char *fileName);
+
+    /// Flush pending records and close the file.
+    ~ReferenceLog();
+
+    /// Set the address space that subsequent references belong to.
+    void SetSpace(unsigned space);
+
+    /// Record a reference to virtual page `vpn` of the current space.
+    void Record(unsigned vpn, bool writing);
+
+private:
+
+    /// Append the current run to the buffer, writing it out when full.
+    void EndRun();
+
+    static const unsigned BUFFER_SIZE = 1024;
+
+    FILE *file;
+    unsigned space;
+    ReferenceRecord run;  ///< Run being accumulated; empty if `count` is 0.
+    ReferenceRecord buffer[BUFFER_SIZE];
+    unsigned buffered;
+};
+
+
+#endif
@@ -19,11 +19,15 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = numCacheWriteBacks = 0;
+    numReadAheads = numReadAheadHits = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numContextSwitches = numUserStateLoads = 0;
 #ifdef DFS_TICKS_FIX
     tickResets = 0;
 #endif
+    histogramFile = nullptr;
 
 }
 
@@ -40,9 +44,52 @@ Statistics::Print()
     printf("Ticks: total %lu, idle %lu, system %lu, user %lu\n",
            totalTicks, idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %lu, writes %lu\n", numDiskReads, numDiskWrites);
+    if (numCacheHits + numCacheMisses != 0)
+        printf("Buffer cache: hits %lu, misses %lu, write-backs %lu\n",
+               numCacheHits, numCacheMisses, numCacheWriteBacks);
+    if (numReadAheads != 0)
+        printf("Read-ahead: sectors %lu, used %lu\n",
+               numReadAheads, numReadAheadHits);
     printf("Console I/O: reads %lu, writes %lu\n",
            numConsoleCharsRead, numConsoleCharsWritten);
     printf("Paging: faults %lu\n", numPageFaults);
     printf("Network I/O: packets received %lu, sent %lu\n",
            numPacketsRecvd, numPacketsSent);
+    printf("Context switches: %lu, user state loads %lu\n",
+           numContextSwitches, numUserStateLoads);
+
+    for (unsigned p = NUM_PRIORITIES; p > 0; p--) {
+        char label[64];
+        if (readyLatency[p - 1].Count() != 0) {
+            snprintf(label, sizeof label, "Ready latency, priority %u", p - 1);
+            readyLatency[p - 1].Print(label);
+        }
+        if (runLength[p - 1].Count() != 0) {
+            snprintf(label, sizeof label, "Run length, priority %u", p - 1);
+            runLength[p - 1].Print(label);
+        }
+    }
+
+    if (handlerTime.Count() != 0)
+        handlerTime.Print("Interrupt handlers, host ns");
+    if (deferredTime.Count() != 0) {
+        deferredTime.Print("Deferred work, host ns");
+        deferredDelay.Print("Deferred work delay");
+    }
+
+    if (histogramFile != nullptr) {
+        fprintf(histogramFile, "interrupt\thandler\tns\t");
+        handlerTime.Write(histogramFile);
+        fprintf(histogramFile, "interrupt\tdeferred\tns\t");
+        deferredTime.Write(histogramFile);
+        fprintf(histogramFile, "interrupt\tdelay\tticks\t");
+        deferredDelay.Write(histogramFile);
+        for (unsigned p = 0; p < NUM_PRIORITIES; p++) {
+            fprintf(histogramFile, "ready\tpriority\t%u\t", p);
+            readyLatency[p].Write(histogramFile);
+            fprintf(histogramFile, "run\tpriority\t%u\t", p);
+            runLength[p].Write(histogramFile);
+        }
+        fflush(histogramFile);
+    }
 }
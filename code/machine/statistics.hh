@@ -11,6 +11,13 @@
 #define NACHOS_MACHINE_STATS__HH
 
 
+#include "lib/histogram.hh"
+
+
+/// Number of thread priorities, for the scheduling histograms.  Must match
+/// `MAX_PRIORITY` in `threads/scheduler.hh`.
+const unsigned NUM_PRIORITIES = 11;
+
 /// The following class defines the statistics that are to be kept about
 /// Nachos behavior -- how much time (ticks) elapsed, how many user
 /// instructions executed, etc.
@@ -44,6 +51,16 @@ public:
     /// Number of characters written to the display.
     unsigned long numConsoleCharsWritten;
 
+    /// Requests to the disk buffer cache that found the sector cached and
+    /// that did not, and modified sectors written back to the disk.
+    unsigned long numCacheHits;
+    unsigned long numCacheMisses;
+    unsigned long numCacheWriteBacks;
+
+    /// Sectors read ahead by the buffer cache, and those of them used.
+    unsigned long numReadAheads;
+    unsigned long numReadAheadHits;
+
     /// Number of virtual memory page faults.
     unsigned long numPageFaults;
 
@@ -53,11 +70,37 @@ public:
     /// Number of packets received over the network.
     unsigned long numPacketsRecvd;
 
+    /// Number of context switches.
+    unsigned long numContextSwitches;
+
+    /// Number of context switches that had to copy user registers into the
+    /// machine.
+    unsigned long numUserStateLoads;
+
 #ifdef DFS_TICKS_FIX
     /// Number of times the tick count gets reset.
     unsigned long tickResets;
 #endif
 
+    /// Time threads of each priority spent ready before running, and time
+    /// they ran (not counting idle time) before giving up the CPU.  Both
+    /// are recorded by the scheduler at every context switch.
+    Histogram readyLatency[NUM_PRIORITIES];
+    Histogram runLength[NUM_PRIORITIES];
+
+    /// Host time, in nanoseconds, spent in each interrupt handler, with
+    /// interrupts disabled, and in each run of deferred work, with them
+    /// enabled.  Simulated time does not advance in either.
+    Histogram handlerTime;
+    Histogram deferredTime;
+
+    /// Time from deferring work until it runs.
+    Histogram deferredDelay;
+
+    /// If not null, `Print` also writes the histograms here, one per line,
+    /// in a machine readable format (see `threads/main.cc`).
+    FILE *histogramFile;
+
     /// Initialize everything to zero.
     Statistics();
 
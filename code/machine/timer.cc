@@ -42,26 +42,55 @@ TimerHandler(void *arg)
 /// * `callArg` is the parameter to be passed to the interrupt handler.
 /// * `doRandom` -- if true, arrange for the interrupts to occur at random,
 ///   instead of fixed, intervals.
-Timer::Timer(VoidFunctionPtr timerHandler, void *callArg, bool doRandom)
+/// * `doTickless` -- if true, only interrupt when armed.
+Timer::Timer(VoidFunctionPtr timerHandler, void *callArg, bool doRandom,
+             bool doTickless)
 {
     randomize = doRandom;
+    tickless  = doTickless;
+    armed     = false;
     handler   = timerHandler;
     arg       = callArg;
 
     // Schedule the first interrupt from the timer device.
+    if (!tickless)
+        Arm();
+}
+
+void
+Timer::Arm()
+{
+    if (armed)
+        return;
+
+    armed = true;
     interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(),
                         TIMER_INT);
 }
 
+bool
+Timer::IsArmed() const
+{
+    return armed;
+}
+
+bool
+Timer::IsTickless() const
+{
+    return tickless;
+}
+
 /// Routine to simulate the interrupt generated by the hardware timer device.
 ///
-/// Schedule the next interrupt, and invoke the interrupt handler.
+/// Schedule the next interrupt, unless tickless, and invoke the interrupt
+/// handler.
 void
 Timer::TimerExpired()
 {
     // Schedule the next timer device interrupt.
-    interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(),
-                        TIMER_INT);
+    armed = false;
+    if (!tickless)
+        Arm();
 
     // Invoke the Nachos interrupt handler for this device.
     (*handler)(arg);
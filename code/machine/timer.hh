@@ -10,6 +10,9 @@
 /// In order to introduce some randomness into time-slicing, if `doRandom` is
 /// set, then the interrupt comes after a random number of ticks.
 ///
+/// A tickless timer interrupts only once each time the kernel arms it,
+/// instead of periodically.
+///
 /// DO NOT CHANGE -- part of the machine emulation
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
@@ -30,10 +33,23 @@ public:
 
     /// Initialize the timer, to call the interrupt handler `timerHandler`
     /// every time slice.
-    Timer(VoidFunctionPtr timerHandler, void *callArg, bool doRandom);
+    ///
+    /// * `doTickless` -- if true, the timer starts disarmed, and each call
+    ///   to `Arm` only buys a single interrupt.
+    Timer(VoidFunctionPtr timerHandler, void *callArg, bool doRandom,
+          bool doTickless = false);
 
     ~Timer() {}
 
+    /// Make sure an interrupt will come at the end of the current time
+    /// slice.  Does nothing if one is already due.
+    void Arm();
+
+    /// Is an interrupt due?
+    bool IsArmed() const;
+
+    bool IsTickless() const;
+
     /// Internal routines to the timer emulation -- DO NOT call these.
 
     /// Called internally when the hardware timer generates an interrupt.
@@ -44,6 +60,8 @@ public:
 
 private:
     bool randomize;  ///< Set if we need to use a random timeout delay.
+    bool tickless;   ///< Set if the timer only interrupts when armed.
+    bool armed;      ///< Set while an interrupt is due.
     VoidFunctionPtr handler;  ///< Timer interrupt handler.
     void *arg;  ///< Argument to pass to interrupt handler.
 
@@ -0,0 +1,226 @@
+/// Routines to record the simulation timeline.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "trace_log.hh"
+#include "threads/system.hh"
+
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+
+
+/// Longest event, once formatted.
+static const size_t MAX_EVENT_SIZE = 512;
+
+/// Copy `s` into `out` as the contents of a JSON string, truncating it if
+/// needed.
+static void
+Escape(const char *s, char *out, size_t size)
+{
+    ASSERT(size > 0);
+
+    if (s == nullptr)
+        s = "";
+
+    size_t n = 0;
+    for (; *s != '\0' && n + 3 < size; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            out[n++] = '\\';
+        out[n++] = c < ' ' ? ' ' : c;
+    }
+    out[n] = '\0';
+}
+
+/// The writer thread blocks every signal, so that the `SIGVTALRM` of the
+/// preemptive scheduler and the `SIGINT` of the user are always delivered
+/// to the simulation.
+TraceLog::TraceLog(const char *fileName, size_t bufSize)
+{
+    ASSERT(fileName != nullptr);
+    ASSERT(bufSize >= 2 * MAX_EVENT_SIZE);
+
+    file = fopen(fileName, "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot create trace `%s`.\n", fileName);
+        ASSERT(false);
+    }
+    fputs("[\n", file);
+
+    bufferSize = bufSize;
+    numEvents  = 0;
+    front      = new char [bufferSize];
+    back       = new char [bufferSize];
+    frontUsed  = 0;
+    backUsed   = 0;
+    backFull   = false;
+    stop       = false;
+
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&changed, nullptr);
+
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int error = pthread_create(&writer, nullptr, WriterMain, this);
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    ASSERT(error == 0);
+
+    NameTrack(CPU_TRACK, "CPU");
+    NameTrack(INTERRUPT_TRACK, "interrupts");
+    NameTrack(DISK_TRACK, "disk");
+}
+
+TraceLog::~TraceLog()
+{
+    if (frontUsed > 0)
+        Swap();
+
+    pthread_mutex_lock(&mutex);
+    stop = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&mutex);
+    pthread_join(writer, nullptr);
+
+    fputs("\n]\n", file);
+    fclose(file);
+
+    pthread_cond_destroy(&changed);
+    pthread_mutex_destroy(&mutex);
+    delete [] front;
+    delete [] back;
+}
+
+void *
+TraceLog::WriterMain(void *arg)
+{
+    TraceLog *log = (TraceLog *) arg;
+
+    pthread_mutex_lock(&log->mutex);
+    for (;;) {
+        while (!log->backFull && !log->stop)
+            pthread_cond_wait(&log->changed, &log->mutex);
+        if (!log->backFull)
+            break;  // Stopped, and nothing left to write.
+
+        pthread_mutex_unlock(&log->mutex);
+        fwrite(log->back, 1, log->backUsed, log->file);
+        pthread_mutex_lock(&log->mutex);
+
+        log->backFull = false;
+        pthread_cond_broadcast(&log->changed);
+    }
+    pthread_mutex_unlock(&log->mutex);
+    return nullptr;
+}
+
+void
+TraceLog::Swap()
+{
+    pthread_mutex_lock(&mutex);
+    while (backFull)
+        pthread_cond_wait(&changed, &mutex);
+
+    char *full = front;
+    front     = back;
+    back      = full;
+    backUsed  = frontUsed;
+    frontUsed = 0;
+    backFull  = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&mutex);
+}
+
+void
+TraceLog::Emit(const char *format, ...)
+{
+    char event[MAX_EVENT_SIZE];
+    va_list ap;
+
+    va_start(ap, format);
+    int length = vsnprintf(event, sizeof event, format, ap);
+    va_end(ap);
+    ASSERT(length > 0 && (size_t) length < sizeof event);
+
+    if (frontUsed + length + 2 > bufferSize)
+        Swap();
+
+    if (numEvents > 0) {
+        front[frontUsed++] = ',';
+        front[frontUsed++] = '\n';
+    }
+    memcpy(front + frontUsed, event, length);
+    frontUsed += length;
+    numEvents++;
+}
+
+/// Events are recorded from threads that may be preempted (see
+/// `threads/preemptive.cc`).  While interrupts are on, host signals are
+/// blocked around the buffer update, so that no other thread can get in
+/// the middle of it.  Disabling interrupts instead would advance the
+/// simulated clock.
+static bool
+BlockPreemption(sigset_t *old)
+{
+    if (interrupt == nullptr || interrupt->GetLevel() == INT_OFF)
+        return false;
+
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, old);
+    return true;
+}
+
+static void
+RestorePreemption(bool blocked, const sigset_t *old)
+{
+    if (blocked)
+        pthread_sigmask(SIG_SETMASK, old, nullptr);
+}
+
+void
+TraceLog::NameTrack(unsigned track, const char *name)
+{
+    char escaped[128];
+    Escape(name, escaped, sizeof escaped);
+
+    sigset_t old;
+    bool blocked = BlockPreemption(&old);
+    Emit("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,"
+         "\"args\":{\"name\":\"%s\"}}", track, escaped);
+    RestorePreemption(blocked, &old);
+}
+
+void
+TraceLog::Span(unsigned track, const char *category, const char *name,
+               unsigned long start, unsigned long end,
+               const char *argName, long arg)
+{
+    ASSERT(category != nullptr);
+
+    char escapedName[128];
+    Escape(name, escapedName, sizeof escapedName);
+    unsigned long duration = end >= start ? end - start : 0;
+
+    sigset_t old;
+    bool blocked = BlockPreemption(&old);
+    if (argName == nullptr)
+        Emit("{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":1,"
+             "\"tid\":%u,\"ts\":%lu,\"dur\":%lu}",
+             category, escapedName, track, start, duration);
+    else
+        Emit("{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":1,"
+             "\"tid\":%u,\"ts\":%lu,\"dur\":%lu,\"args\":{\"%s\":%ld}}",
+             category, escapedName, track, start, duration, argName, arg);
+    RestorePreemption(blocked, &old);
+}
+
+unsigned long
+TraceLog::NumEvents() const
+{
+    return numEvents;
+}
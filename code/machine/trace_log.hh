@@ -0,0 +1,97 @@
+/// Timeline of the simulation, in the Chrome trace event format.
+///
+/// When enabled (with `-tr`), the kernel and the devices report spans of
+/// simulated time here: which thread holds the CPU and when it idles,
+/// interrupt handlers, disk requests, system calls and page faults.  The
+/// resulting JSON file can be opened with `chrome://tracing` or Perfetto;
+/// timestamps are simulated ticks, shown as microseconds.
+///
+/// Events are formatted into a memory buffer.  Full buffers are written to
+/// the file by a host thread, so that the simulation does not wait on the
+/// disk of the host.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_TRACELOG__HH
+#define NACHOS_MACHINE_TRACELOG__HH
+
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+
+
+/// Tracks of the timeline.  Every thread also gets its own track, numbered
+/// `FIRST_THREAD_TRACK` plus its identifier.
+enum {
+    CPU_TRACK,         ///< The thread running, or idle time.
+    INTERRUPT_TRACK,   ///< Interrupt handlers.
+    DISK_TRACK,        ///< Disk requests, until their completion.
+    FIRST_THREAD_TRACK = 16
+};
+
+class TraceLog {
+public:
+
+    /// Create the file `fileName` and start the writer.
+    ///
+    /// * `bufferSize` is the size of each of the two buffers, in bytes.
+    TraceLog(const char *fileName, size_t bufferSize = 1 << 16);
+
+    /// Write all pending events and close the file.
+    ~TraceLog();
+
+    /// Give `track` a name in the viewer.
+    void NameTrack(unsigned track, const char *name);
+
+    /// Add a span from `start` to `end` on `track`.
+    ///
+    /// * `category` and `name` are shown by the viewer; both are copied.
+    /// * `argName`, if not null, names an integer argument with value
+    ///   `arg` attached to the span.
+    void Span(unsigned track, const char *category, const char *name,
+              unsigned long start, unsigned long end,
+              const char *argName = nullptr, long arg = 0);
+
+    /// Number of events so far.
+    unsigned long NumEvents() const;
+
+private:
+
+    /// Format one event into the front buffer, preceded by a separator if
+    /// needed.
+    void Emit(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+    /// Hand the front buffer to the writer, waiting if it is still busy
+    /// with the back one.
+    void Swap();
+
+    /// Body of the writer thread.
+    static void *WriterMain(void *arg);
+
+    FILE *file;
+    size_t bufferSize;
+    unsigned long numEvents;
+
+    /// Buffer being filled by the simulation.
+    char *front;
+    size_t frontUsed;
+
+    /// Buffer being written, owned by the writer while `backFull`.
+    char *back;
+    size_t backUsed;
+    bool backFull;
+
+    /// Tells the writer to finish once the back buffer is written.
+    bool stop;
+
+    pthread_t writer;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+};
+
+
+#endif
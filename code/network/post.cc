@@ -19,6 +19,7 @@
 
 
 #include "post.hh"
+#include "threads/system.hh"
 
 #include <stdio.h>
 #include <string.h>
@@ -176,6 +177,9 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
     // First, initialize the synchronization with the interrupt handlers.
     messageAvailable = new Semaphore("message available", 0);
     messageSent      = new Semaphore("message sent", 0);
+    packetsArrived   = 0;
+    packetsSent      = 0;
+    wakeUp           = new DeferredWork(WakeWaiters, this);
     sendLock         = new Lock("message send lock");
 
     // Second, initialize the mailboxes.
@@ -201,6 +205,7 @@ PostOffice::~PostOffice()
     delete [] boxes;
     delete messageAvailable;
     delete messageSent;
+    delete wakeUp;
     delete sendLock;
 }
 
@@ -307,7 +312,8 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
 void
 PostOffice::IncomingPacket()
 {
-    messageAvailable->V();
+    packetsArrived++;
+    interrupt->Defer(wakeUp);
 }
 
 /// Interrupt handler, called when the next packet can be put onto the
@@ -318,5 +324,33 @@ PostOffice::IncomingPacket()
 void
 PostOffice::PacketSent()
 {
-    messageSent->V();
+    packetsSent++;
+    interrupt->Defer(wakeUp);
+}
+
+/// Take one from a counter of interrupts, if not zero.  Interrupts are
+/// disabled meanwhile, since the handlers increment it.
+static bool
+TakeOne(unsigned *count)
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    bool any = *count > 0;
+    if (any)
+        (*count)--;
+    interrupt->SetLevel(oldLevel);
+    return any;
+}
+
+/// A handler that runs meanwhile (a semaphore may enable interrupts) defers
+/// this again, so nothing is left behind.
+void
+PostOffice::WakeWaiters(void *arg)
+{
+    ASSERT(arg != nullptr);
+    PostOffice *po = (PostOffice *) arg;
+
+    while (TakeOne(&po->packetsArrived))
+        po->messageAvailable->V();
+    while (TakeOne(&po->packetsSent))
+        po->messageSent->V();
 }
@@ -28,6 +28,7 @@
 
 
 #include "network.hh"
+#include "machine/interrupt.hh"
 #include "threads/synch_list.hh"
 
 
@@ -145,6 +146,10 @@ public:
 
 private:
 
+    /// Deferred by the interrupt handlers: wake up the threads waiting for
+    /// the packets that arrived or were sent since the last run.
+    static void WakeWaiters(void *arg);
+
     /// Physical network connection.
     Network *network;
 
@@ -163,6 +168,11 @@ private:
     // `V`'ed when next message can be sent to network.
     Semaphore *messageSent;
 
+    /// Interrupts not yet passed on to the semaphores above.
+    unsigned packetsArrived;
+    unsigned packetsSent;
+    DeferredWork *wakeUp;
+
     // Only one outgoing message at a time.
     Lock *sendLock;
 
@@ -0,0 +1,103 @@
+/// Routines to put threads to sleep for a period of time.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "alarm_clock.hh"
+#include "system.hh"
+
+
+AlarmClock::AlarmClock()
+{
+    alarm   = nullptr;
+    alarmAt = 0;
+}
+
+/// Like the timer, the alarm clock is only deleted as Nachos halts; its
+/// pending interrupt, if any, is freed along with the rest.
+AlarmClock::~AlarmClock()
+{}
+
+/// The thread goes after any other due at the same time, so that sleepers
+/// with equal deadlines wake up in the order they went to sleep.
+void
+AlarmClock::Sleep(unsigned long ticks)
+{
+    if (ticks == 0)
+        return;
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    currentThread->wakeAt = stats->totalTicks + ticks;
+    DEBUG('t', "Thread \"%s\" sleeping until time %lu\n",
+          currentThread->GetName(), currentThread->wakeAt);
+
+    Thread *next = sleepers.Head();
+    while (next != nullptr && next->wakeAt <= currentThread->wakeAt)
+        next = sleepers.Next(next);
+    sleepers.InsertBefore(currentThread, next);
+    Arm();
+
+    currentThread->Sleep();
+    interrupt->SetLevel(oldLevel);
+}
+
+bool
+AlarmClock::HasSleepers() const
+{
+    return !sleepers.IsEmpty();
+}
+
+unsigned long
+AlarmClock::NextDeadline() const
+{
+    ASSERT(!sleepers.IsEmpty());
+    return sleepers.Head()->wakeAt;
+}
+
+/// The pending interrupt is rebased along with the others, so only the
+/// recorded times change.
+void
+AlarmClock::Rebase(unsigned long elapsed)
+{
+    for (Thread *t = sleepers.Head(); t != nullptr; t = sleepers.Next(t))
+        t->wakeAt = t->wakeAt > elapsed ? t->wakeAt - elapsed : 0;
+    alarmAt = alarmAt > elapsed ? alarmAt - elapsed : 0;
+}
+
+void
+AlarmClock::Arm()
+{
+    ASSERT(interrupt->GetLevel() == INT_OFF);
+
+    Thread *first = sleepers.Head();
+    if (alarm != nullptr && (first == nullptr || alarmAt != first->wakeAt)) {
+        interrupt->Cancel(alarm);
+        alarm = nullptr;
+    }
+    if (first == nullptr || alarm != nullptr)
+        return;
+
+    ASSERT(first->wakeAt > stats->totalTicks);
+    alarmAt = first->wakeAt;
+    alarm   = interrupt->Schedule(Expired, this,
+                                  alarmAt - stats->totalTicks, TIMEOUT_INT);
+}
+
+void
+AlarmClock::Expired(void *arg)
+{
+    AlarmClock *clock = (AlarmClock *) arg;
+    clock->alarm = nullptr;  // Deleted by the interrupt simulation.
+
+    Thread *thread;
+    while ((thread = clock->sleepers.Head()) != nullptr
+             && thread->wakeAt <= stats->totalTicks) {
+        clock->sleepers.Remove(thread);
+        DEBUG('t', "Waking up thread \"%s\"\n", thread->GetName());
+        scheduler->ReadyToRun(thread);
+    }
+    clock->Arm();
+}
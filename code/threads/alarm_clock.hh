@@ -0,0 +1,69 @@
+/// Data structures for putting threads to sleep for a period of time.
+///
+/// A sleeping thread is blocked: it is on no ready structure, so it uses
+/// no CPU and, under the stride policy, accumulates no pass.  Sleepers are
+/// kept sorted by the time they are due, and a single interrupt is pending
+/// at any time, for the earliest of them.  Since that interrupt is a real
+/// pending event, an otherwise idle machine fast-forwards to it instead of
+/// halting.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_ALARMCLOCK__HH
+#define NACHOS_THREADS_ALARMCLOCK__HH
+
+
+#include "thread.hh"
+#include "lib/intrusive_list.hh"
+#include "machine/interrupt.hh"
+
+
+class AlarmClock {
+public:
+
+    /// Initialize an alarm clock with no sleepers.
+    AlarmClock();
+
+    /// Forget about any threads still sleeping.
+    ~AlarmClock();
+
+    /// Block the current thread for `ticks` ticks of simulated time.
+    ///
+    /// It becomes ready once they have passed; when it runs again depends
+    /// on the scheduler.
+    void Sleep(unsigned long ticks);
+
+    /// Is any thread sleeping?
+    bool HasSleepers() const;
+
+    /// Time at which the first sleeper is due; there must be one.
+    unsigned long NextDeadline() const;
+
+    /// Called when simulated time is restarted from 0 after `elapsed`
+    /// ticks (see `Interrupt::RestartTicks`), to keep the deadlines, which
+    /// are absolute times, in step.
+    void Rebase(unsigned long elapsed);
+
+private:
+
+    /// Interrupt handler: wake up every thread that is due.
+    static void Expired(void *arg);
+
+    /// Make the pending interrupt match the first sleeper, if any.
+    void Arm();
+
+    /// Sleeping threads, in order of `Thread::wakeAt`, linked through
+    /// `Thread::queueLink`.
+    IntrusiveList<Thread, &Thread::queueLink> sleepers;
+
+    /// Interrupt scheduled for the first sleeper, or null.
+    PendingInterrupt *alarm;
+
+    /// Time `alarm` is due.
+    unsigned long alarmAt;
+};
+
+
+#endif
@@ -0,0 +1,231 @@
+/// Data structures for passing items between threads through a bounded
+/// buffer.
+///
+/// Unlike `Channel`, which hands a single `int` over at a time and makes
+/// the sender wait for the receiver, a `BoundedChannel` carries any
+/// copyable type and lets senders run ahead of receivers until the buffer
+/// is full.  Items are kept in a ring allocated once, so sending and
+/// receiving never allocate memory, and `SendMany`/`ReceiveMany` move a
+/// whole batch under a single acquisition of the lock.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_BOUNDEDCHANNEL__HH
+#define NACHOS_THREADS_BOUNDEDCHANNEL__HH
+
+
+#include "synch.hh"
+
+
+template <class Item>
+class BoundedChannel {
+public:
+
+    /// Initialize an empty channel with room for `capacity` items.
+    BoundedChannel(const char *debugName, unsigned capacity);
+
+    /// De-allocate the channel.  No thread may be waiting on it.
+    ~BoundedChannel();
+
+    const char *GetName() const;
+
+    /// Put `item` in the channel, waiting while it is full.
+    void Send(const Item &item);
+
+    /// Take the oldest item out of the channel into `item`, waiting while
+    /// it is empty.
+    void Receive(Item *item);
+
+    /// Put the `count` items of `items` in the channel, in order, waiting
+    /// for room as many times as needed.
+    void SendMany(const Item *items, unsigned count);
+
+    /// Take between 1 and `max` items out of the channel into `items`,
+    /// waiting only while it is empty.
+    ///
+    /// Returns how many items were taken.
+    unsigned ReceiveMany(Item *items, unsigned max);
+
+    /// Like `Send`, but return false instead of waiting if the channel is
+    /// full.
+    bool TrySend(const Item &item);
+
+    /// Like `Receive`, but return false instead of waiting if the channel
+    /// is empty.
+    bool TryReceive(Item *item);
+
+private:
+
+    /// Copy up to `count` items from `items` into the ring; the lock must
+    /// be held.  Returns how many fit.
+    unsigned Put(const Item *items, unsigned count);
+
+    /// Copy up to `max` items from the ring into `items`; the lock must be
+    /// held.  Returns how many there were.
+    unsigned Take(Item *items, unsigned max);
+
+    const char *name;
+
+    /// The ring: `count` items starting at `ring[head]`, wrapping around.
+    Item *ring;
+    unsigned capacity;
+    unsigned head;
+    unsigned count;
+
+    Lock *lock;
+
+    /// Wait in `Send` while the ring is full.
+    Condition *notFull;
+
+    /// Wait in `Receive` while the ring is empty.
+    Condition *notEmpty;
+};
+
+template <class Item>
+BoundedChannel<Item>::BoundedChannel(const char *debugName,
+                                     unsigned ringCapacity)
+{
+    ASSERT(ringCapacity > 0);
+
+    name     = debugName;
+    ring     = new Item [ringCapacity];
+    capacity = ringCapacity;
+    head     = 0;
+    count    = 0;
+    lock     = new Lock(debugName);
+    notFull  = new Condition(debugName, lock);
+    notEmpty = new Condition(debugName, lock);
+}
+
+template <class Item>
+BoundedChannel<Item>::~BoundedChannel()
+{
+    delete notEmpty;
+    delete notFull;
+    delete lock;
+    delete [] ring;
+}
+
+template <class Item>
+const char *
+BoundedChannel<Item>::GetName() const
+{
+    return name;
+}
+
+template <class Item>
+unsigned
+BoundedChannel<Item>::Put(const Item *items, unsigned n)
+{
+    unsigned put = 0;
+    for (; put < n && count < capacity; put++, count++) {
+        unsigned tail = head + count;
+        if (tail >= capacity)
+            tail -= capacity;
+        ring[tail] = items[put];
+    }
+    return put;
+}
+
+template <class Item>
+unsigned
+BoundedChannel<Item>::Take(Item *items, unsigned max)
+{
+    unsigned taken = 0;
+    for (; taken < max && count > 0; taken++, count--) {
+        items[taken] = ring[head];
+        if (++head == capacity)
+            head = 0;
+    }
+    return taken;
+}
+
+template <class Item>
+void
+BoundedChannel<Item>::Send(const Item &item)
+{
+    SendMany(&item, 1);
+}
+
+template <class Item>
+void
+BoundedChannel<Item>::Receive(Item *item)
+{
+    ASSERT(item != nullptr);
+    ReceiveMany(item, 1);
+}
+
+/// A single item only needs a single receiver, but a batch may satisfy
+/// several of them.
+template <class Item>
+void
+BoundedChannel<Item>::SendMany(const Item *items, unsigned n)
+{
+    ASSERT(items != nullptr || n == 0);
+
+    lock->Acquire();
+    while (n > 0) {
+        while (count == capacity)
+            notFull->Wait();
+
+        unsigned put = Put(items, n);
+        items += put;
+        n     -= put;
+        if (put == 1)
+            notEmpty->Signal();
+        else
+            notEmpty->Broadcast();
+    }
+    lock->Release();
+}
+
+template <class Item>
+unsigned
+BoundedChannel<Item>::ReceiveMany(Item *items, unsigned max)
+{
+    ASSERT(items != nullptr);
+    ASSERT(max > 0);
+
+    lock->Acquire();
+    while (count == 0)
+        notEmpty->Wait();
+
+    unsigned taken = Take(items, max);
+    if (taken == 1)
+        notFull->Signal();
+    else
+        notFull->Broadcast();
+    lock->Release();
+    return taken;
+}
+
+template <class Item>
+bool
+BoundedChannel<Item>::TrySend(const Item &item)
+{
+    lock->Acquire();
+    bool sent = Put(&item, 1) == 1;
+    if (sent)
+        notEmpty->Signal();
+    lock->Release();
+    return sent;
+}
+
+template <class Item>
+bool
+BoundedChannel<Item>::TryReceive(Item *item)
+{
+    ASSERT(item != nullptr);
+
+    lock->Acquire();
+    bool received = Take(item, 1) == 1;
+    if (received)
+        notFull->Signal();
+    lock->Release();
+    return received;
+}
+
+
+#endif
@@ -10,10 +10,15 @@
 /// Usage
 /// =====
 ///
-///     nachos [-d <debugflags>] [-p] [-rs <random seed #>] [-z]
+///     nachos [-d <debugflags>] [-p [<time slice>]] [-rs <random seed #>]
+///            [-sp <policy>] [-tl] [-lp] [-sh <histogram file>]
+///            [-tr <trace file>] [-z] [-tb [tsv]]
 ///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>]
+///            [-rl <reference log>]
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
 ///            [-rm <nachos file>] [-ls] [-D] [-tf]
+///            [-bc <sectors>] [-bp <policy>] [-ra <sectors>]
+///            [-wb <ticks>]
 ///            [-n <network reliability>] [-id <machine id>]
 ///            [-tn <other machine id>]
 ///
@@ -22,9 +27,38 @@
 ///
 /// * `-d`  -- causes certain debugging messages to be printed (cf.
 ///   `utility.hh`).
-/// * `-p`  -- enables preemptive multitasking for kernel threads.
+/// * `-p`  -- enables preemptive multitasking for kernel threads.  The time
+///   slice is measured in microseconds of host CPU time; if `-rs` is also
+///   given, it is measured in simulated ticks, so that runs are repeatable.
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
+/// * `-sp` -- selects the scheduling policy: `prio` (strict priorities, the
+///   default), `mlfq` (multi-level feedback queue), or `stride` or `lottery`
+///   (CPU shares proportional to tickets, which grow with priority).
+/// * `-tl` -- makes the timer tickless: instead of interrupting every time
+///   slice, it is only armed while some thread is ready besides the running
+///   one, so that the machine idles without interruptions.
+/// * `-lp` -- profiles contention on semaphores, locks, condition
+///   variables, readers-writer locks and barriers, and reports the most
+///   contended ones when halting.
+/// * `-sh` -- writes the scheduling histograms (time spent ready before
+///   running, and length of each run, in ticks) to a file, one per line.
+///   Fields are tab separated: `ready` or `run`; `priority` or `thread`;
+///   the priority or thread name; the number of samples, their sum and
+///   maximum; and the count of each bucket -- bucket 0 counts zeros, and
+///   bucket `i` counts values from `2^(i-1)` to `2^i - 1`.  Per-thread
+///   lines are written when threads are destroyed, and for the running
+///   thread when halting.  Lines starting with `interrupt` hold the host
+///   time of interrupt handlers and deferred work, in nanoseconds, and the
+///   ticks that deferred work waited to run.
+/// * `-tr` -- writes a timeline of the simulation to a file in the Chrome
+///   trace event format, for `chrome://tracing` or Perfetto: thread runs
+///   and idle time, interrupt handlers, disk requests, system calls and
+///   page faults.  Timestamps are simulated ticks.
 /// * `-z`  -- prints version and copyright information, and exits.
+/// * `-tb` -- runs the synchronization benchmark, and exits.  With `tsv`,
+///   prints the results as tab separated values (see
+///   `threads/synch_bench.cc`).  Only in the threads build, since the
+///   benchmark replaces the global allocator to count allocations.
 ///
 /// *USER_PROGRAM* options
 /// ----------------------
@@ -32,6 +66,8 @@
 /// * `-s`  -- causes user programs to be executed in single-step mode.
 /// * `-x`  -- runs a user program.
 /// * `-tc` -- tests the console.
+/// * `-rl` -- records the page references of user programs into a host
+///   file, for replay with `bin/refsim`.
 ///
 /// *FILESYS* options
 /// -----------------
@@ -43,6 +79,16 @@
 /// * `-ls` -- lists the contents of the Nachos directory.
 /// * `-D`  -- prints the contents of the entire file system.
 /// * `-tf` -- tests the performance of the Nachos file system.
+/// * `-bc` -- sets the number of sectors of the disk buffer cache (32 by
+///   default; 0 disables it).
+/// * `-bp` -- sets the replacement policy of the buffer cache: `lru` (the
+///   default) or `2q`.
+/// * `-ra` -- sets the largest number of sectors read ahead of a file being
+///   read sequentially (8 by default, and at most a quarter of the cache; 0
+///   disables reading ahead).
+/// * `-wb` -- sets how many ticks a sector may stay modified in the buffer
+///   cache before it is written back (30000 by default; 0 leaves it until
+///   it is replaced or the cache is flushed).
 ///
 /// *NETWORK* options
 /// -----------------
@@ -78,6 +124,7 @@
 // External functions used by this file.
 
 void ThreadTest();
+void SynchBenchmark(bool tsv);
 void Copy(const char *unixFile, const char *nachosFile);
 void Print(const char *file);
 void PerformanceTest(void);
@@ -118,6 +165,12 @@ main(int argc, char **argv)
             PrintVersion();
             return 0;
         }
+#ifdef THREADS
+        if (!strcmp(*argv, "-tb")) {         // Benchmark synchronization.
+            SynchBenchmark(argc > 1 && !strcmp(*(argv + 1), "tsv"));
+            interrupt->Halt();
+        }
+#endif
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {          // Run a user program.
             ASSERT(argc > 1);
@@ -173,6 +226,9 @@ main(int argc, char **argv)
 #ifdef THREADS
     ThreadTest();
 #endif
+#ifdef FILESYS
+    bufferCache->Flush();  // Must block, so it cannot wait for `Halt`.
+#endif
 
     currentThread->Finish();
       // NOTE: if the procedure `main` returns, then the program `nachos`
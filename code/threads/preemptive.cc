@@ -11,166 +11,133 @@
 // Access to global objects: `currentThread`, `interrupt`...
 #include "system.hh"
 
-// UNIX and Linux-specific headers.
-#include <unistd.h>
-#include <sys/ptrace.h>
-#include <sys/wait.h>
-#include <sys/user.h>
+// UNIX-specific headers.
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
 
-#include <stdlib.h>
 
+/// Set while the signal handler is switching threads, so that a nested
+/// signal does not try to switch again.
+static volatile sig_atomic_t inContextSwitch = false;
 
-static void ContextSwitch();
-static void MonitorProcess(int childPid, unsigned long timeSliceLength);
-static void LetMeBeMonitored();
+static volatile unsigned long numPreemptions = 0;
 
-static bool inContextSwitch = false;
-
-/// Set up the preemptive scheduler.
+/// Preempt the running thread, at the nearest safe point.
 ///
-/// * `timeSliceLength` means how many machine instructions will last the
-///   time slice for every kernel thread.
-void
-PreemptiveScheduler::SetUp(unsigned long timeSliceLength)
+/// A thread may only be switched out right away if interrupts are enabled:
+/// then, as far as the kernel is concerned, it could have called `Yield`
+/// itself.  Otherwise (interrupts disabled, an interrupt handler or
+/// deferred work running, or a switch already in progress) the yield is
+/// deferred with `YieldOnReturn` and happens once that is over.
+static void
+Preempt()
 {
-    int childPid = fork();
-    switch (childPid) {
-        case -1:
-            DEBUG('p',
-                  "Preemptive scheduler: unable to launch child process\n");
-            ASSERT(false);
-            break;
-
-        // Child process: original Nachos code.
-        case 0:
-            LetMeBeMonitored();
-            // Resume Nachos execution as a child process.
-            return;
-
-        // Parent process: monitor code.
-        default:
-            MonitorProcess(childPid, timeSliceLength);
+    if (interrupt->GetStatus() == IDLE_MODE)
+        return;
+    numPreemptions++;
+
+    if (inContextSwitch || interrupt->GetLevel() == INT_OFF
+          || interrupt->InDeferred()) {
+        interrupt->YieldOnReturn();
+        return;
     }
+
+    // Once interrupts are off, nested signals will defer themselves; the
+    // flag covers the window until then.
+    inContextSwitch = true;
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    inContextSwitch = false;
+    currentThread->Yield();
+    interrupt->SetLevel(oldLevel);
 }
 
-void
-LetMeBeMonitored()
+/// `SIGVTALRM` handler.
+///
+/// The handler is installed with `SA_NODEFER`: if the running thread is
+/// switched out from inside it, the signal must stay unblocked for the
+/// thread that runs next.
+static void
+SignalHandler(int)
 {
-    // Allow the parent process to ptrace me.
-    ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
-
-    DEBUG ('p', "Preemptive scheduler: child process will be ptraced\n");
+    Preempt();
+}
 
-    // Raise a signal to bring back control to the parent.
-    raise(SIGUSR1);
+PreemptiveScheduler::PreemptiveScheduler()
+{
+    timeSlice     = 0;
+    deterministic = false;
+    running       = false;
 }
 
-void
-MonitorProcess(int childPid, unsigned long timeSliceLength)
+PreemptiveScheduler::~PreemptiveScheduler()
 {
-    // Machine instruction counter.
-    long long instructionCounter = 1;
-
-    while (true) {
-
-        // Wait for child process.
-        int wait_val;
-        wait(&wait_val);
-        if (WIFEXITED(wait_val)) {
-            DEBUG('p', "Preemptive scheduler: child process terminated\n");
-            break;
-        }
-
-        // Increment instruction counter.
-        instructionCounter++;
-
-        // From time to time, insert machine code to force a context switch.
-        if (instructionCounter % timeSliceLength == 0)
-        {
-            // Get child value of `inContextSwitch`.
-            long incs = ptrace(PTRACE_PEEKDATA, childPid,
-                               (long) &inContextSwitch, nullptr);
-
-            if (incs == 0) {
-                DEBUG('p', "Preemptive scheduler: "
-                           "forcing a context switch at instruction %lld\n",
-                      instructionCounter);
-
-                struct user_regs_struct regs;
-
-                // Get child process registers.
-                ptrace(PTRACE_GETREGS,  childPid, nullptr, &regs);
-
-                // Build a call stack frame by inserting EIP/RIP on top of
-                // the stack.
-#ifdef HOST_i386
-                regs.esp = regs.esp - 4;
-                ptrace(PTRACE_POKEDATA, childPid, regs.esp, regs.eip);
-                // Force a jump to `ContextSwitch`.
-                regs.eip = (long) ContextSwitch;
-#elif defined(HOST_x86_64)
-                regs.rsp = regs.rsp - 8;
-                ptrace(PTRACE_POKEDATA, childPid, regs.rsp, regs.rip);
-                // Force a jump to ContextSwitch`.
-                regs.rip = (long long) ContextSwitch;
-#endif
-
-                // Store new register values in the child process. The child
-                // will now make a call to `ContextSwitch`.
-                ptrace(PTRACE_SETREGS, childPid, nullptr, &regs);
-            }
-        }
-
-        // Resume child execution.
-        ptrace(PTRACE_SINGLESTEP, childPid, nullptr, nullptr);
-    }
+    if (!running || deterministic)
+        return;
 
-    DEBUG('p', "Preemptive scheduler: Finished\n");
-    exit(0);
+    struct itimerval stop;
+    memset(&stop, 0, sizeof stop);
+    setitimer(ITIMER_VIRTUAL, &stop, nullptr);
+    signal(SIGVTALRM, SIG_DFL);
 }
 
-
-/// Force a context switch.
+/// Set up the preemptive scheduler.
 ///
-/// This call is made asynchronously from the parent process, using `ptrace`
-/// features.
-static void
-ContextSwitch(void)
+/// * `timeSliceLength` is the duration of the time slice for every kernel
+///   thread.
+/// * `deterministicSlice` selects simulated ticks instead of host time.
+void
+PreemptiveScheduler::SetUp(unsigned long timeSliceLength,
+                           bool deterministicSlice)
 {
-    // Prevent register loss: save all registers.
-#ifdef HOST_i386
-    __asm__ ("pushal");
-    __asm__ ("subl $8, %esp");
-#elif defined(HOST_x86_64)
-    // Push all registers.
-    __asm__ ("push %rax; push %rbx; push %rcx; push %rdx");
-    __asm__ ("push %rsi; push %rdi; push %rsp; push %rbp");
-    __asm__ ("push %r8; push %r9; push %r10; push %r11; "
-             "push %r12; push %r13; push %r14; push %r15");
-    __asm__ ("sub $16, %rsp");
-#endif
+    ASSERT(!running);
+    ASSERT(timeSliceLength > 0);
+
+    timeSlice     = timeSliceLength;
+    deterministic = deterministicSlice;
+    running       = true;
+
+    if (deterministic) {
+        DEBUG('p', "Preemptive scheduler: time slice of %lu ticks\n",
+              timeSlice);
+        interrupt->Schedule(TickHandler, this, timeSlice, TIMER_INT);
+        return;
+    }
 
-    inContextSwitch = true;
+    DEBUG('p', "Preemptive scheduler: time slice of %lu us\n", timeSlice);
 
-    // Make a context switch if interrupts are enabled.
-    if (interrupt->GetLevel() == INT_ON) {
-        inContextSwitch = false;
-        currentThread->Yield();
-    } else {
-        interrupt->YieldOnReturn();
-        inContextSwitch = false;
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = SignalHandler;
+    action.sa_flags   = SA_NODEFER | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGVTALRM, &action, nullptr) != 0) {
+        DEBUG('p', "Preemptive scheduler: unable to install handler\n");
+        ASSERT(false);
     }
 
-    // Restore old register values.
-#ifdef HOST_i386
-    __asm__ ("addl $8, %esp");
-    __asm__ ("popal");
-#elif defined(HOST_x86_64)
-    __asm__ ("add $16, %rsp");
-    // Pop all registers.
-    __asm__ ("pop %r15; pop %r14; pop %r13; pop %r12; "
-             "pop %r11; pop %r10; pop %r9; pop %r8");
-    __asm__ ("pop %rbp; pop %rsp; pop %rdi; pop %rsi");
-    __asm__ ("pop %rdx; pop %rcx; pop %rbx; pop %rax");
-#endif
+    struct itimerval slice;
+    slice.it_interval.tv_sec  = timeSlice / 1000000;
+    slice.it_interval.tv_usec = timeSlice % 1000000;
+    slice.it_value = slice.it_interval;
+    if (setitimer(ITIMER_VIRTUAL, &slice, nullptr) != 0) {
+        DEBUG('p', "Preemptive scheduler: unable to start timer\n");
+        ASSERT(false);
+    }
+}
+
+unsigned long
+PreemptiveScheduler::GetNumPreemptions() const
+{
+    return numPreemptions;
+}
+
+/// Runs as an interrupt handler, so the yield is always deferred until the
+/// handler returns.
+void
+PreemptiveScheduler::TickHandler(void *arg)
+{
+    PreemptiveScheduler *self = (PreemptiveScheduler *) arg;
+    Preempt();
+    interrupt->Schedule(TickHandler, self, self->timeSlice, TIMER_INT);
 }
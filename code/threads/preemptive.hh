@@ -1,6 +1,13 @@
 /// Extension to make kernel threads be periodically preempted.
 ///
-/// It only works on Linux x86 environments.
+/// Two time sources are available:
+///
+/// * by default, a host interval timer (`setitimer` with `ITIMER_VIRTUAL`)
+///   delivers `SIGVTALRM` every time slice of host CPU time, and the signal
+///   handler preempts the running thread;
+/// * when Nachos is seeded with `-rs`, runs must be repeatable, so the time
+///   slice is instead measured in simulated ticks, with a periodic
+///   interrupt.
 ///
 /// Copyright (c) 2007      Universidad de Las Palmas de Gran Canaria.
 ///               2016-2020 Docentes de la Universidad Nacional de Rosario.
@@ -16,18 +23,29 @@
 class PreemptiveScheduler {
 public:
 
-    PreemptiveScheduler()
-    {}
+    PreemptiveScheduler();
 
-    ~PreemptiveScheduler()
-    {}
+    /// Stop time slicing.
+    ~PreemptiveScheduler();
 
     /// Set up time slicing between kernel threads.
     ///
-    /// * `timeSliceLength` is the time slice duration, measured in native
-    ///   x86 machine instructions.
-    void SetUp(unsigned long timeSliceLength);
+    /// * `timeSliceLength` is the time slice duration, measured in
+    ///   microseconds of host CPU time, or in simulated ticks if
+    ///   `deterministic` is true.
+    void SetUp(unsigned long timeSliceLength, bool deterministic = false);
+
+    /// Number of preemptions requested so far.
+    unsigned long GetNumPreemptions() const;
+
+private:
+
+    /// Periodic interrupt handler, for deterministic time slicing.
+    static void TickHandler(void *arg);
 
+    unsigned long timeSlice;
+    bool deterministic;
+    bool running;
 };
 
 
@@ -9,8 +9,12 @@
 /// needed to wait for a lock, and the lock was busy, we would end up calling
 /// `FindNextToRun`, and that would put us in an infinite loop.
 ///
-/// Very simple implementation -- no priorities, straight FIFO.  Might need
-/// to be improved in later assignments.
+/// Threads are kept in one FIFO queue per priority, linked through the
+/// threads themselves, plus a bitmap of the non-empty queues.  Hence
+/// enqueuing, dequeuing and changing the priority of a ready thread take
+/// constant time and do not allocate memory.  The proportional-share
+/// policies keep them in a `ShareTree` instead, where the same operations
+/// take logarithmic time.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2020 Docentes de la Universidad Nacional de Rosario.
@@ -22,24 +26,78 @@
 #include "system.hh"
 
 #include <stdio.h>
+#include <string.h>
 
 
+static_assert(MAX_PRIORITY < sizeof (unsigned) * 8,
+              "the ready mask needs one bit per priority");
+static_assert(MAX_PRIORITY + 1 == NUM_PRIORITIES,
+              "statistics need one histogram per priority");
+
+static const char *const POLICY_NAMES[] = {
+    "prio", "mlfq", "stride", "lottery"
+};
+
+bool
+ParseSchedulingPolicy(const char *name, SchedulingPolicy *policy)
+{
+    ASSERT(name != nullptr);
+    ASSERT(policy != nullptr);
+
+    for (unsigned i = 0; i < NUM_SCHEDULING_POLICIES; i++) {
+        if (!strcmp(name, POLICY_NAMES[i])) {
+            *policy = (SchedulingPolicy) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned long
+MlfqQuantum(unsigned level)
+{
+    ASSERT(level <= MAX_PRIORITY);
+    return TIMER_TICKS * (MAX_PRIORITY + 1 - level);
+}
+
+unsigned
+TicketsOf(unsigned priority)
+{
+    return (priority + 1) * TICKETS_PER_PRIORITY;
+}
+
+/// Time that the machine has not spent idle.  Used to charge threads, so
+/// that idle time is not charged to the thread that blocked before it.
+///
+/// Unlike `totalTicks`, this never goes back when the tick count is
+/// restarted.
+static inline unsigned long
+BusyTicks()
+{
+    return stats->userTicks + stats->systemTicks;
+}
+
 /// Initialize the list of ready but not running threads to empty.
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulingPolicy schedulingPolicy)
 {
-  for (int i = 0; i <= MAX_PRIORITY; i++) {
-    readyList[i] = new List<Thread *>;
-  }
+    ASSERT(schedulingPolicy < NUM_SCHEDULING_POLICIES);
 
+    policy          = schedulingPolicy;
+    readyMask       = 0;
+    lastUserTicks   = 0;
+    lastSystemTicks = 0;
+    nextAging       = MLFQ_AGING_PERIOD;
+    globalPass      = 0;
+    dispatchedAt    = 0;
+    lightSwitch     = true;
+#ifdef USER_PROGRAM
+    userStateOwner  = nullptr;
+#endif
 }
 
 /// De-allocate the list of ready threads.
 Scheduler::~Scheduler()
-{
-  for (int i = 0; i <= MAX_PRIORITY; i++) {
-    delete readyList[i];
-  }
-}
+{}
 
 /// Mark a thread as ready, but not running.
 /// Put it on the ready list, for later scheduling onto the CPU.
@@ -52,8 +110,31 @@ Scheduler::ReadyToRun(Thread *thread)
 
     DEBUG('t', "Putting thread %s on ready list\n", thread->GetName());
 
+    if (thread == currentThread)
+        Account(thread);
+    else if (policy == MLFQ_POLICY && thread->GetStatus() == BLOCKED
+               && thread->mlfqLevel < MAX_PRIORITY) {
+        // Woken up: reward threads that block instead of computing.
+        thread->mlfqLevel++;
+        thread->levelTicks = 0;
+    } else if (policy == STRIDE_POLICY && thread->pass < globalPass)
+        thread->pass = globalPass;
+
     thread->SetStatus(READY);
-    readyList[thread->GetPriority()]->Append(thread);
+    thread->readySince = stats->totalTicks;
+    if (IsProportional())
+        shares.Insert(thread, TicketsOf(thread->GetPriority()));
+    else {
+        unsigned level = LevelOf(thread);
+        thread->readyLevel = level;
+        readyList[level].Append(thread);
+        readyMask |= 1U << level;
+    }
+
+    // If the running thread is the one made ready, it is about to give
+    // up the CPU, and `Run` takes care of the timer.
+    if (thread != currentThread && currentThread->GetStatus() == RUNNING)
+        ArmTimer();
 }
 
 /// Return the next thread to be scheduled onto the CPU.
@@ -64,15 +145,37 @@ Scheduler::ReadyToRun(Thread *thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-  int i;
-  for (i = MAX_PRIORITY; i >= 1 && readyList[i]->IsEmpty(); i--);
-  return readyList[i]->Pop();
+    if (policy == STRIDE_POLICY) {
+        Thread *thread = shares.PopMinPass();
+        if (thread != nullptr && thread->pass > globalPass)
+            globalPass = thread->pass;
+        return thread;
+    }
+    if (policy == LOTTERY_POLICY) {
+        if (shares.IsEmpty())
+            return nullptr;
+        unsigned long ticket = (unsigned long) SystemDep::Random()
+                               % shares.TotalWeight();
+        return shares.PopTicket(ticket);
+    }
+
+    if (readyMask == 0)
+        return nullptr;
+
+    // Highest non-empty priority.
+    unsigned level = sizeof readyMask * 8 - 1 - __builtin_clz(readyMask);
+    Thread *thread = readyList[level].Pop();
+    if (readyList[level].IsEmpty())
+        readyMask &= ~(1U << level);
+    return thread;
 }
 
 /// Dispatch the CPU to `nextThread`.
 ///
 /// Save the state of the old thread, and load the state of the new thread,
-/// by calling the machine dependent context switch routine, `SWITCH`.
+/// by calling the machine dependent context switch routine, `SWITCH` or
+/// `SWITCH_LIGHT`.  User registers are not copied here unless the new
+/// thread needs them (see `LoadUserState`).
 ///
 /// Note: we assume the state of the previously running thread has already
 /// been changed from running to blocked or ready (depending).
@@ -87,19 +190,12 @@ Scheduler::Run(Thread *nextThread)
 
     Thread *oldThread = currentThread;
 
-#ifdef USER_PROGRAM  // Ignore until running user programs.
-    if (currentThread->space != nullptr) {
-        // If this thread is a user program, save the user's CPU registers.
-        currentThread->SaveUserState();
-        currentThread->space->SaveState();
-    }
-#endif
-
-    oldThread->CheckOverflow();  // Check if the old thread had an undetected
-                                 // stack overflow.
+    Account(oldThread);
+    RecordSwitch(oldThread, nextThread);
 
     currentThread = nextThread;  // Switch to the next thread.
     currentThread->SetStatus(RUNNING);  // `nextThread` is now running.
+    ArmTimer();
 
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
           oldThread->GetName(), nextThread->GetName());
@@ -109,7 +205,11 @@ Scheduler::Run(Thread *nextThread)
     // after this, both from the point of view of the thread and from the
     // perspective of the “outside world”.
 
-    SWITCH(oldThread, nextThread);
+    stats->numContextSwitches++;
+    if (lightSwitch)
+        SWITCH_LIGHT(oldThread, nextThread);
+    else
+        SWITCH(oldThread, nextThread);
 
     DEBUG('t', "Now in thread \"%s\"\n", currentThread->GetName());
 
@@ -123,14 +223,60 @@ Scheduler::Run(Thread *nextThread)
     }
 
 #ifdef USER_PROGRAM
-    if (currentThread->space != nullptr) {
-        // If there is an address space to restore, do it.
-        currentThread->RestoreUserState();
-        currentThread->space->RestoreState();
-    }
+    LoadUserState(currentThread);
 #endif
 }
 
+void
+Scheduler::SetLightSwitch(bool light)
+{
+    lightSwitch = light;
+}
+
+#ifdef USER_PROGRAM
+
+/// Threads that only run in the kernel never touch the user registers, so
+/// a user thread that blocks and gets the CPU back, with only kernel
+/// threads running in between, finds its registers as it left them.
+void
+Scheduler::LoadUserState(Thread *thread)
+{
+    ASSERT(thread != nullptr);
+
+    if (thread->space == nullptr || thread == userStateOwner)
+        return;
+
+    if (userStateOwner != nullptr) {
+        userStateOwner->SaveUserState();
+        userStateOwner->space->SaveState();
+    }
+    thread->RestoreUserState();
+    thread->space->RestoreState();
+    userStateOwner = thread;
+    stats->numUserStateLoads++;
+}
+
+void
+Scheduler::ClaimUserState()
+{
+    ASSERT(currentThread->space != nullptr);
+
+    if (userStateOwner != nullptr && userStateOwner != currentThread) {
+        userStateOwner->SaveUserState();
+        userStateOwner->space->SaveState();
+    }
+    userStateOwner = currentThread;
+}
+
+void
+Scheduler::ForgetUserState(Thread *thread)
+{
+    if (thread == userStateOwner)
+        userStateOwner = nullptr;
+}
+
+#endif
+
 /// Print the scheduler state -- in other words, the contents of the ready
 /// list.
 ///
@@ -146,18 +292,222 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    for (int i = 0; i < MAX_PRIORITY; i++) {
-      readyList[i]->Apply(ThreadPrint);
-      printf("\n");
+    if (IsProportional()) {
+        printf("  ");
+        shares.Apply(ThreadPrint);
+        printf("\n");
+        return;
+    }
+    for (int i = MAX_PRIORITY; i >= 0; i--) {
+        if (readyList[i].IsEmpty())
+            continue;
+        printf("  priority %d: ", i);
+        readyList[i].Apply(ThreadPrint);
+        printf("\n");
     }
 }
 
 void
-Scheduler::UpdatePriority(Thread *thread){
-  for (unsigned i = 0; i <= MAX_PRIORITY; i++) {
-    if (readyList[i]->Has(thread)) {
-      readyList[i]->Remove(thread);
-      readyList[thread->GetPriority()]->Append(thread);
+Scheduler::UpdatePriority(Thread *thread)
+{
+    ASSERT(thread != nullptr);
+
+    if (thread->GetStatus() != READY)
+        return;
+
+    if (IsProportional()) {
+        // The pass is kept, only the tickets change.
+        shares.Remove(thread);
+        shares.Insert(thread, TicketsOf(thread->GetPriority()));
+        return;
+    }
+
+    if (thread->readyLevel == LevelOf(thread))
+        return;
+
+    unsigned level = thread->readyLevel;
+    readyList[level].Remove(thread);
+    if (readyList[level].IsEmpty())
+        readyMask &= ~(1U << level);
+    ReadyToRun(thread);
+}
+
+void
+Scheduler::ChargeCurrent()
+{
+    Account(currentThread);
+}
+
+SchedulingPolicy
+Scheduler::GetPolicy() const
+{
+    return policy;
+}
+
+bool
+Scheduler::NeedsTimer() const
+{
+    return policy != PRIORITY_POLICY;
+}
+
+bool
+Scheduler::IsProportional() const
+{
+    return policy == STRIDE_POLICY || policy == LOTTERY_POLICY;
+}
+
+/// Under strict priorities, every timer interrupt ends the time slice.
+/// Under MLFQ, the running thread keeps the CPU until it uses up its
+/// quantum, unless a thread at a higher level is ready.  Under stride, it
+/// keeps it while no ready thread is behind it.
+///
+/// Under lottery, the draw for the next time slice is made here, with the
+/// tickets of the running thread included; `Thread::Yield` then draws
+/// among the others only if the running thread lost.
+bool
+Scheduler::ShouldPreempt()
+{
+    if (policy == STRIDE_POLICY) {
+        Account(currentThread);
+        return !shares.IsEmpty() && shares.MinPass() < currentThread->pass;
+    }
+    if (policy == LOTTERY_POLICY) {
+        unsigned long mine = TicketsOf(currentThread->GetPriority());
+        unsigned long ticket = (unsigned long) SystemDep::Random()
+                               % (shares.TotalWeight() + mine);
+        return ticket >= mine;
+    }
+    if (policy != MLFQ_POLICY)
+        return true;
+
+    unsigned oldLevel = currentThread->mlfqLevel;
+    Account(currentThread);
+    if (currentThread->mlfqLevel != oldLevel)
+        return true;  // Quantum used up.
+
+    unsigned level = LevelOf(currentThread);
+    return (readyMask >> level) > 1;  // Someone above us is ready.
+}
+
+unsigned
+Scheduler::LevelOf(const Thread *thread) const
+{
+    ASSERT(thread != nullptr);
+
+    unsigned priority = thread->GetPriority();
+    if (policy == MLFQ_POLICY && thread->mlfqLevel > priority)
+        return thread->mlfqLevel;
+    return priority;
+}
+
+/// Run lengths are measured in busy ticks, so that the idle time before the
+/// next thread becomes ready is not counted.  Samples spanning a restart of
+/// the tick counter are dropped.
+void
+Scheduler::RecordSwitch(Thread *oldThread, Thread *nextThread)
+{
+    ASSERT(oldThread != nullptr);
+    ASSERT(nextThread != nullptr);
+
+    unsigned long busy = BusyTicks();
+    unsigned long ran = busy - oldThread->runSince;
+    oldThread->runLength.Record(ran);
+    stats->runLength[oldThread->GetPriority()].Record(ran);
+
+    // The machine only idles right before a switch, when the old thread has
+    // blocked, so the run ended `ran` busy ticks after it started.
+    if (traceLog != nullptr)
+        traceLog->Span(CPU_TRACK, "sched", oldThread->GetName(),
+                       dispatchedAt, dispatchedAt + ran,
+                       "thread", oldThread->id);
+    dispatchedAt = stats->totalTicks;
+
+    if (stats->totalTicks >= nextThread->readySince) {
+        unsigned long waited = stats->totalTicks - nextThread->readySince;
+        nextThread->readyLatency.Record(waited);
+        nextThread->usage.readyTicks += waited;
+        stats->readyLatency[nextThread->GetPriority()].Record(waited);
+    }
+    nextThread->runSince = busy;
+}
+
+void
+Scheduler::Account(Thread *thread)
+{
+    ASSERT(thread != nullptr);
+
+    unsigned long user   = stats->userTicks   - lastUserTicks;
+    unsigned long system = stats->systemTicks - lastSystemTicks;
+    lastUserTicks   = stats->userTicks;
+    lastSystemTicks = stats->systemTicks;
+
+    thread->usage.userTicks   += user;
+    thread->usage.systemTicks += system;
+    unsigned long used = user + system;
+
+    if (policy == STRIDE_POLICY) {
+        // A ready thread must not move in the tree; it cannot have run
+        // since it was charged, anyway.
+        ASSERT(used == 0 || thread->GetStatus() != READY);
+        thread->pass += used * STRIDE_ONE / TicketsOf(thread->GetPriority());
+        return;
+    }
+    if (policy != MLFQ_POLICY)
+        return;
+
+    unsigned long now = BusyTicks();
+
+    if (now >= nextAging) {
+        Age();
+        nextAging = now + MLFQ_AGING_PERIOD;
+    }
+
+    thread->levelTicks += used;
+    if (thread->levelTicks >= MlfqQuantum(thread->mlfqLevel)) {
+        if (thread->mlfqLevel > 0)
+            thread->mlfqLevel--;
+        thread->levelTicks = 0;
+        DEBUG('t', "Demoting thread \"%s\" to level %u\n",
+              thread->GetName(), thread->mlfqLevel);
+    }
+}
+
+bool
+Scheduler::HasReady() const
+{
+    return IsProportional() ? !shares.IsEmpty() : readyMask != 0;
+}
+
+/// With a periodic timer, `Timer::Arm` does nothing, as an interrupt is
+/// always due.
+void
+Scheduler::ArmTimer()
+{
+    if (timer != nullptr && HasReady())
+        timer->Arm();
+}
+
+/// Blocked threads keep their level until they wake up; the boost they get
+/// then is usually enough for them.
+void
+Scheduler::Age()
+{
+    DEBUG('t', "Aging: moving ready threads to the top level\n");
+
+    currentThread->mlfqLevel  = MAX_PRIORITY;
+    currentThread->levelTicks = 0;
+
+    ThreadQueue aged;
+    Thread *thread;
+    while ((thread = FindNextToRun()) != nullptr) {
+        thread->mlfqLevel  = MAX_PRIORITY;
+        thread->levelTicks = 0;
+        aged.Append(thread);
+    }
+    while ((thread = aged.Pop()) != nullptr) {
+        unsigned level = LevelOf(thread);
+        thread->readyLevel = level;
+        readyList[level].Append(thread);
+        readyMask |= 1U << level;
     }
-  }
 }
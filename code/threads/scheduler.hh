@@ -12,9 +12,67 @@
 
 
 #include "thread.hh"
-#include "lib/list.hh"
+#include "share_tree.hh"
+#include "lib/intrusive_list.hh"
+#include "machine/statistics.hh"
 
 #define MAX_PRIORITY 10
+
+
+/// Policies for choosing the next thread to run.
+enum SchedulingPolicy {
+    /// Strict priorities: always run a thread of the highest priority, round
+    /// robin among threads of equal priority.
+    PRIORITY_POLICY,
+
+    /// Multi-level feedback queue: threads start at the top level, go down
+    /// one level each time they use up the quantum of their level, and go
+    /// up one level when they wake up after blocking.  All threads are
+    /// periodically moved back to the top level, so that none starves.  The
+    /// static priority of a thread is a floor for its level.
+    MLFQ_POLICY,
+
+    /// Stride scheduling: each thread gets a share of the CPU proportional
+    /// to its tickets, which grow with its priority.  The thread that has
+    /// received the least service relative to its share runs next, so
+    /// shares are met deterministically.
+    STRIDE_POLICY,
+
+    /// Lottery scheduling: like stride, but the next thread is drawn at
+    /// random with probability proportional to its tickets, so shares are
+    /// only met on average.
+    LOTTERY_POLICY,
+
+    NUM_SCHEDULING_POLICIES
+};
+
+/// Parse a policy name (`prio`, `mlfq`, `stride` or `lottery`); returns
+/// false if unknown.
+bool ParseSchedulingPolicy(const char *name, SchedulingPolicy *policy);
+
+/// CPU time a thread may use at MLFQ level `level` before being demoted.
+///
+/// Lower levels get longer quanta.
+unsigned long MlfqQuantum(unsigned level);
+
+/// Period of the MLFQ aging, in ticks.
+const unsigned long MLFQ_AGING_PERIOD = 100 * TIMER_TICKS;
+
+/// Tickets given to each priority level by the proportional-share
+/// policies.
+const unsigned TICKETS_PER_PRIORITY = 100;
+
+/// Tickets of a thread of priority `priority`.
+///
+/// A thread of priority `p` gets `p + 1` times the share of a thread of
+/// priority 0.  Priority donation through locks thus becomes a ticket
+/// transfer.
+unsigned TicketsOf(unsigned priority);
+
+/// Pass increment of a thread with a single ticket after running one tick.
+const unsigned long long STRIDE_ONE = 1 << 20;
+
+
 /// The following class defines the scheduler/dispatcher abstraction --
 /// the data structures and operations needed to keep track of which
 /// thread is running, and which threads are ready but not running.
@@ -22,7 +80,7 @@ class Scheduler {
 public:
 
     /// Initialize list of ready threads.
-    Scheduler();
+    Scheduler(SchedulingPolicy schedulingPolicy = PRIORITY_POLICY);
 
     /// De-allocate ready list.
     ~Scheduler();
@@ -40,12 +98,110 @@ public:
     void Print();
 
     /// Updates the priority of a thread.
+    ///
+    /// If the thread is ready to run, it is moved to the queue of its new
+    /// priority.
     void UpdatePriority(Thread *thread);
 
+    /// Bring the CPU time counters of the running thread up to date.
+    void ChargeCurrent();
+
+    SchedulingPolicy GetPolicy() const;
+
+    /// Does the policy need periodic timer interrupts to enforce quanta?
+    bool NeedsTimer() const;
+
+    /// Called from the timer interrupt handler: should the running thread
+    /// be preempted?
+    bool ShouldPreempt();
+
+    /// Is any thread ready to run, besides the running one?
+    bool HasReady() const;
+
+    /// Choose the context switch routine: `SWITCH_LIGHT`, which only keeps
+    /// the registers that survive a function call, or the full `SWITCH`.
+    /// The light one is the default; the full one is kept for comparison.
+    void SetLightSwitch(bool light);
+
+#ifdef USER_PROGRAM
+    /// The running thread is about to set up its user registers from
+    /// scratch: save those of whatever thread left them in the machine, and
+    /// make it their owner.
+    void ClaimUserState();
+
+    /// `thread` is going away; if it owns the user registers in the
+    /// machine, nobody does anymore.
+    void ForgetUserState(Thread *thread);
+#endif
+
 private:
 
-    // Queue of threads that are ready to run, but not running.
-    List<Thread*> *readyList[MAX_PRIORITY + 1];
+    /// Ready list level for `thread` under the current policy.
+    unsigned LevelOf(const Thread *thread) const;
+
+    /// Charge `thread`, which is the running thread, with the user and
+    /// system time used since the last dispatch, advancing its pass or
+    /// demoting it if the policy says so.
+    void Account(Thread *thread);
+
+    /// Record the run that `oldThread` ends and the wait that `nextThread`
+    /// ends in the scheduling histograms.
+    void RecordSwitch(Thread *oldThread, Thread *nextThread);
+
+    /// Move every thread back to the top MLFQ level.
+    void Age();
+
+    /// With a tickless timer, arm it if some thread is ready, since the
+    /// running one may then have to be preempted.
+    void ArmTimer();
+
+    /// Is the policy one of the proportional-share ones?
+    bool IsProportional() const;
+
+#ifdef USER_PROGRAM
+    /// Make the user registers and address space of `thread`, which has
+    /// just been dispatched, the ones in the machine, if it is a user
+    /// thread and they are not already.
+    void LoadUserState(Thread *thread);
+
+    /// Thread whose user registers and address space are in the machine,
+    /// or null.  They are only saved when another user thread needs the
+    /// machine, so switching to kernel threads and back copies nothing.
+    Thread *userStateOwner;
+#endif
+
+    /// Use `SWITCH_LIGHT` instead of `SWITCH`.
+    bool lightSwitch;
+
+    SchedulingPolicy policy;
+
+    /// User and system ticks at the last dispatch or accounting.
+    unsigned long lastUserTicks;
+    unsigned long lastSystemTicks;
+
+    /// Time of the last dispatch, for the trace.
+    unsigned long dispatchedAt;
+
+    /// Busy ticks at which the next MLFQ aging is due.
+    unsigned long nextAging;
+
+    typedef IntrusiveList<Thread, &Thread::queueLink> ThreadQueue;
+
+    // Queues of threads that are ready to run, but not running; one per
+    // priority.
+    ThreadQueue readyList[MAX_PRIORITY + 1];
+
+    /// Bit `i` is set if and only if `readyList[i]` is not empty.
+    unsigned readyMask;
+
+    /// Ready threads under the proportional-share policies, which do not
+    /// use `readyList`.
+    ShareTree shares;
+
+    /// Pass of the last thread dispatched by the stride policy.  Threads
+    /// that become ready after blocking start no further behind, so that
+    /// they cannot claim the CPU for the time they were not using it.
+    unsigned long long globalPass;
 
 };
 
@@ -0,0 +1,192 @@
+/// Routines to manage the proportional-share ready structure.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "share_tree.hh"
+#include "lib/utility.hh"
+
+
+/// Is `a` to be preferred to `b` by the stride policy?  Null threads lose.
+static inline bool
+SmallerPass(const Thread *a, const Thread *b)
+{
+    if (a == nullptr)
+        return false;
+    if (b == nullptr)
+        return true;
+    return a->pass < b->pass;
+}
+
+ShareTree::ShareTree(unsigned initialCapacity)
+{
+    ASSERT(initialCapacity > 0);
+
+    capacity = 1;
+    while (capacity < initialCapacity)
+        capacity *= 2;
+
+    nodes = new Node [2 * capacity];
+    for (unsigned i = 0; i < 2 * capacity; i++) {
+        nodes[i].weight = 0;
+        nodes[i].min    = nullptr;
+    }
+
+    // Push in reverse order, so that low slots are used first.
+    freeSlots = new unsigned [capacity];
+    numFree   = 0;
+    for (unsigned s = capacity; s > 0; s--)
+        freeSlots[numFree++] = s - 1;
+}
+
+ShareTree::~ShareTree()
+{
+    delete [] nodes;
+    delete [] freeSlots;
+}
+
+void
+ShareTree::Combine(unsigned i)
+{
+    const Node &left  = nodes[2 * i];
+    const Node &right = nodes[2 * i + 1];
+
+    nodes[i].weight = left.weight + right.weight;
+    nodes[i].min    = SmallerPass(right.min, left.min) ? right.min : left.min;
+}
+
+void
+ShareTree::FixUp(unsigned slot)
+{
+    for (unsigned i = (capacity + slot) / 2; i > 0; i /= 2)
+        Combine(i);
+}
+
+/// Slots keep their numbers, so the threads already in the tree do not
+/// need to be told.
+void
+ShareTree::Grow()
+{
+    ASSERT(numFree == 0);
+
+    unsigned newCapacity = 2 * capacity;
+    Node *newNodes = new Node [2 * newCapacity];
+
+    for (unsigned i = 0; i < newCapacity; i++) {
+        newNodes[i].weight = 0;
+        newNodes[i].min    = nullptr;
+    }
+    for (unsigned s = 0; s < newCapacity; s++) {
+        if (s < capacity)
+            newNodes[newCapacity + s] = nodes[capacity + s];
+        else {
+            newNodes[newCapacity + s].weight = 0;
+            newNodes[newCapacity + s].min    = nullptr;
+        }
+    }
+
+    unsigned *newFreeSlots = new unsigned [newCapacity];
+    for (unsigned s = newCapacity; s > capacity; s--)
+        newFreeSlots[numFree++] = s - 1;
+
+    delete [] nodes;
+    delete [] freeSlots;
+    nodes     = newNodes;
+    freeSlots = newFreeSlots;
+    capacity  = newCapacity;
+
+    for (unsigned i = capacity - 1; i > 0; i--)
+        Combine(i);
+}
+
+void
+ShareTree::Insert(Thread *thread, unsigned weight)
+{
+    ASSERT(thread != nullptr);
+    ASSERT(weight > 0);
+
+    if (numFree == 0)
+        Grow();
+
+    unsigned slot = freeSlots[--numFree];
+    thread->shareSlot = slot;
+    nodes[capacity + slot].weight = weight;
+    nodes[capacity + slot].min    = thread;
+    FixUp(slot);
+}
+
+void
+ShareTree::Remove(Thread *thread)
+{
+    ASSERT(thread != nullptr);
+
+    unsigned slot = thread->shareSlot;
+    ASSERT(slot < capacity && nodes[capacity + slot].min == thread);
+
+    nodes[capacity + slot].weight = 0;
+    nodes[capacity + slot].min    = nullptr;
+    FixUp(slot);
+    freeSlots[numFree++] = slot;
+}
+
+Thread *
+ShareTree::PopMinPass()
+{
+    Thread *thread = nodes[1].min;
+    if (thread != nullptr)
+        Remove(thread);
+    return thread;
+}
+
+Thread *
+ShareTree::PopTicket(unsigned long ticket)
+{
+    ASSERT(ticket < nodes[1].weight);
+
+    unsigned i = 1;
+    while (i < capacity) {
+        if (ticket < nodes[2 * i].weight)
+            i = 2 * i;
+        else {
+            ticket -= nodes[2 * i].weight;
+            i = 2 * i + 1;
+        }
+    }
+
+    Thread *thread = nodes[i].min;
+    ASSERT(thread != nullptr);
+    Remove(thread);
+    return thread;
+}
+
+unsigned long long
+ShareTree::MinPass() const
+{
+    ASSERT(nodes[1].min != nullptr);
+    return nodes[1].min->pass;
+}
+
+unsigned long
+ShareTree::TotalWeight() const
+{
+    return nodes[1].weight;
+}
+
+bool
+ShareTree::IsEmpty() const
+{
+    return nodes[1].min == nullptr;
+}
+
+void
+ShareTree::Apply(void (*func)(Thread *)) const
+{
+    ASSERT(func != nullptr);
+
+    for (unsigned s = 0; s < capacity; s++) {
+        if (nodes[capacity + s].min != nullptr)
+            func(nodes[capacity + s].min);
+    }
+}
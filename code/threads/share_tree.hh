@@ -0,0 +1,88 @@
+/// Ready structure for the proportional-share scheduling policies.
+///
+/// A complete binary tree over a fixed number of slots, each holding at
+/// most one ready thread.  Every node keeps the total of the ticket weights
+/// below it and the thread with the smallest stride pass below it, so
+/// that inserting, removing, taking the thread of smallest pass and drawing
+/// a lottery ticket all take logarithmic time.  Slots are reused; the tree
+/// doubles when it runs out of them and never shrinks, so once it reaches
+/// its working size it does no further heap allocation.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_SHARETREE__HH
+#define NACHOS_THREADS_SHARETREE__HH
+
+
+#include "thread.hh"
+
+
+class ShareTree {
+public:
+
+    /// Create an empty tree with room for `initialCapacity` threads.
+    ShareTree(unsigned initialCapacity = 16);
+
+    ~ShareTree();
+
+    /// Add `thread`, which must not be in the tree, with `weight` tickets.
+    ///
+    /// The pass of the thread is read when comparing, so it must not be
+    /// changed while the thread is in the tree.
+    void Insert(Thread *thread, unsigned weight);
+
+    /// Take `thread`, which must be in the tree, out of it.
+    void Remove(Thread *thread);
+
+    /// Remove and return the thread with the smallest pass, or null if the
+    /// tree is empty.
+    Thread *PopMinPass();
+
+    /// Remove and return the thread holding ticket number `ticket`, which
+    /// must be smaller than `TotalWeight()`.
+    Thread *PopTicket(unsigned long ticket);
+
+    /// Smallest pass of the threads in the tree; the tree must not be
+    /// empty.
+    unsigned long long MinPass() const;
+
+    /// Total number of tickets of the threads in the tree.
+    unsigned long TotalWeight() const;
+
+    bool IsEmpty() const;
+
+    /// Apply `func` to every thread in the tree, in slot order.
+    void Apply(void (*func)(Thread *)) const;
+
+private:
+
+    struct Node {
+        unsigned long weight;
+        Thread *min;  ///< Thread of smallest pass below; null if none.
+    };
+
+    /// Recompute the internal node `i` from its children.
+    void Combine(unsigned i);
+
+    /// Recompute the ancestors of slot `slot`.
+    void FixUp(unsigned slot);
+
+    /// Double the number of slots.
+    void Grow();
+
+    /// Number of slots (leaves); always a power of two.
+    unsigned capacity;
+
+    /// Node 1 is the root; the children of node `i` are `2*i` and `2*i+1`;
+    /// slot `s` is node `capacity + s`.
+    Node *nodes;
+
+    /// Stack of unused slots.
+    unsigned *freeSlots;
+    unsigned numFree;
+};
+
+
+#endif
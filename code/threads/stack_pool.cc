@@ -0,0 +1,92 @@
+/// Routines to manage the pool of thread stacks.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "stack_pool.hh"
+#include "lib/utility.hh"
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+StackPool::StackPool(unsigned maxFreeStacks)
+{
+    freeStacks = nullptr;
+    numFree    = 0;
+    maxFree    = maxFreeStacks;
+    pageSize   = getpagesize();
+}
+
+StackPool::~StackPool()
+{
+    while (freeStacks != nullptr) {
+        FreeStack *s = freeStacks;
+        freeStacks = s->next;
+        munmap((char *) s - pageSize, s->size + pageSize);
+    }
+}
+
+size_t
+StackPool::RoundSize(size_t size) const
+{
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+/// Reuse an unused stack of the same size if there is one; otherwise map a
+/// new one, together with its guard page.
+char *
+StackPool::Allocate(size_t size)
+{
+    ASSERT(size > 0);
+    size = RoundSize(size);
+
+    for (FreeStack **p = &freeStacks; *p != nullptr; p = &(*p)->next) {
+        if ((*p)->size == size) {
+            FreeStack *s = *p;
+            *p = s->next;
+            numFree--;
+            return (char *) s;
+        }
+    }
+
+    char *region = (char *) mmap(nullptr, size + pageSize,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        perror("StackPool: cannot map thread stack");
+        ASSERT(false);
+    }
+    if (mprotect(region, pageSize, PROT_NONE) != 0) {
+        perror("StackPool: cannot protect guard page");
+        ASSERT(false);
+    }
+    return region + pageSize;
+}
+
+void
+StackPool::Free(char *stack, size_t size)
+{
+    ASSERT(stack != nullptr);
+    size = RoundSize(size);
+
+    if (numFree == maxFree) {
+        munmap(stack - pageSize, size + pageSize);
+        return;
+    }
+
+    FreeStack *s = (FreeStack *) stack;
+    s->size = size;
+    s->next = freeStacks;
+    freeStacks = s;
+    numFree++;
+}
+
+unsigned
+StackPool::NumFree() const
+{
+    return numFree;
+}
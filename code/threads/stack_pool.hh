@@ -0,0 +1,60 @@
+/// A pool of thread execution stacks.
+///
+/// Stacks are mapped directly from the host with `mmap`, with an
+/// inaccessible guard page right below them, so that a thread overflowing
+/// its stack faults immediately instead of silently corrupting memory.
+/// Stacks of finished threads are kept and handed out again to new threads
+/// asking for the same size, which saves the system calls on thread
+/// creation.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_STACKPOOL__HH
+#define NACHOS_THREADS_STACKPOOL__HH
+
+
+#include <stddef.h>
+
+
+class StackPool {
+public:
+
+    /// Create an empty pool that keeps at most `maxFree` unused stacks.
+    StackPool(unsigned maxFree = 64);
+
+    /// Unmap all the unused stacks.
+    ~StackPool();
+
+    /// Get a stack of at least `size` bytes.
+    ///
+    /// Returns the lowest usable address of the stack; the page just below
+    /// it is a guard page.
+    char *Allocate(size_t size);
+
+    /// Give back a stack obtained from `Allocate` with the same `size`.
+    void Free(char *stack, size_t size);
+
+    /// Number of stacks currently kept for reuse.
+    unsigned NumFree() const;
+
+private:
+
+    /// Header written at the bottom of an unused stack.
+    struct FreeStack {
+        FreeStack *next;
+        size_t size;  ///< Usable size, rounded up to whole pages.
+    };
+
+    /// Round `size` up to a multiple of the host page size.
+    size_t RoundSize(size_t size) const;
+
+    FreeStack *freeStacks;
+    unsigned numFree;
+    unsigned maxFree;
+    size_t pageSize;
+};
+
+
+#endif
@@ -31,11 +31,13 @@
 ///
 /// * `debugName` is an arbitrary name, useful for debugging.
 /// * `initialValue` is the initial value of the semaphore.
-Semaphore::Semaphore(const char *debugName, int initialValue)
+/// * `profiled` tells whether to count contention on it, if profiling.
+Semaphore::Semaphore(const char *debugName, int initialValue, bool profiled)
 {
     name  = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
+    profile = profiled && synchProfile != nullptr
+              ? synchProfile->Register(SEMAPHORE_KIND, debugName) : nullptr;
 }
 
 /// De-allocate semaphore, when no longer needed.
@@ -43,7 +45,7 @@ Semaphore::Semaphore(const char *debugName, int initialValue)
 /// Assume no one is still waiting on the semaphore!
 Semaphore::~Semaphore()
 {
-    delete queue;
+    ASSERT(queue.IsEmpty());
 }
 
 const char *
@@ -68,12 +70,21 @@ Semaphore::P()
     IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
       // Disable interrupts.
 
+    bool blocked = value == 0 && profile != nullptr;
+    unsigned long since = blocked ? profile->Blocking() : 0;
+
     while (value == 0) {  // Semaphore not available.
-        queue->Append(currentThread);  // So go to sleep.
+        queue.Append(currentThread);  // So go to sleep.
         currentThread->Sleep();
     }
     value--;  // Semaphore available, consume its value.
 
+    if (profile != nullptr) {
+        profile->operations++;
+        if (blocked)
+            profile->Woken(since);
+    }
+
     interrupt->SetLevel(oldLevel);  // Re-enable interrupts.
 }
 
@@ -90,10 +101,13 @@ Semaphore::V()
     #endif
     IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
 
-    Thread *thread = queue->Pop();
-    if (thread != nullptr)
+    Thread *thread = queue.Pop();
+    if (thread != nullptr) {
         // Make thread ready, consuming the `V` immediately.
         scheduler->ReadyToRun(thread);
+        if (profile != nullptr)
+            profile->wakeups++;
+    }
     value++;
 
     interrupt->SetLevel(oldLevel);
@@ -104,18 +118,79 @@ Semaphore::V()
 /// Note -- without a correct implementation of `Condition::Wait`, the test
 /// case in the network assignment will not work!
 
-Lock::Lock(const char *debugName)
+/// Times a thread yields before blocking on a barging lock, as long as the
+/// holder is ready to run.
+static const unsigned LOCK_SPIN_YIELDS = 3;
+
+#ifdef INVPRIO
+/// Longest chain of locks a donation is passed along.
+static const unsigned MAX_DONATION_DEPTH = 8;
+
+/// Lend `priority` to `thread` and, if it is blocked on a lock, to the
+/// holder of that lock, and so on along the chain.
+///
+/// Returns whether `thread` got a higher priority.
+static bool
+DonatePriority(Thread *thread, unsigned priority)
 {
-  name = debugName;
-  state = new Semaphore(debugName, 1);
-  holder = nullptr;
+    bool donated = false;
+    for (unsigned depth = 0; thread != nullptr && depth < MAX_DONATION_DEPTH;
+         depth++) {
+        if (thread->GetPriority() >= priority)
+            break;
+        thread->SetPriority(priority);
+        scheduler->UpdatePriority(thread);
+        donated = donated || depth == 0;
+        thread = thread->waitingOn != nullptr
+                 ? thread->waitingOn->GetHolder() : nullptr;
+    }
+    return donated;
+}
+
+/// Give the current thread back its own priority, raised only as much as
+/// the waiters of the locks it still holds require, including those of
+/// readers-writer locks it holds for writing.
+static void
+RestorePriority()
+{
+    unsigned priority = currentThread->GetOldPriority();
+    for (Lock *l = currentThread->heldLocks; l != nullptr; l = l->nextHeld) {
+        unsigned waiting = l->WaiterPriority();
+        if (waiting > priority)
+            priority = waiting;
+    }
+    for (RWLock *l = currentThread->heldRWLocks; l != nullptr;
+         l = l->nextHeld) {
+        unsigned waiting = l->WaiterPriority();
+        if (waiting > priority)
+            priority = waiting;
+    }
+    if (priority != currentThread->GetPriority()) {
+        currentThread->SetPriority(priority);
+        scheduler->UpdatePriority(currentThread);
+    }
+}
+#endif
+
+/// Locks keep their own queue of waiters, instead of a semaphore, so that
+/// `Release` can choose which waiter gets the lock, and whether it is
+/// handed over or left free.
+Lock::Lock(const char *debugName, LockPolicy lockPolicy)
+{
+    name       = debugName;
+    policy     = lockPolicy;
+    holder     = nullptr;
+    nextHeld   = nullptr;
+    convoy     = 0;
+    profile    = synchProfile != nullptr
+                 ? synchProfile->Register(LOCK_KIND, debugName) : nullptr;
+    acquiredAt = 0;
 }
 
 Lock::~Lock()
 {
-  name = nullptr;
-  delete state;
-  holder = nullptr;
+    ASSERT(holder == nullptr);
+    ASSERT(waiters.IsEmpty());
 }
 
 const char *
@@ -124,21 +199,56 @@ Lock::GetName() const
     return name;
 }
 
+/// Under barging, a woken waiter may find the lock taken again, and has to
+/// wait once more.  Under handoff, it is woken up as the holder.
 void
 Lock::Acquire()
 {
     ASSERT(!IsHeldByCurrentThread());
 
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    bool blocked = holder != nullptr;
 #ifdef INVPRIO
-    if (holder && holder->GetPriority() < currentThread->GetPriority()) {
-      // TODO: Agregar mensaje de debug
-      holder->SetPriority(currentThread->GetPriority());
-      scheduler->UpdatePriority(holder);
-    }
+    // Before spinning too, so that yielding lets the holder run rather
+    // than some thread of intermediate priority.
+    if (blocked && DonatePriority(holder, currentThread->GetPriority())
+          && profile != nullptr)
+        profile->donations++;
 #endif
+    if (policy == LOCK_BARGING) {
+        for (unsigned i = 0; i < LOCK_SPIN_YIELDS && holder != nullptr
+                               && holder->GetStatus() == READY; i++)
+            currentThread->Yield();
+    }
 
-    state->P();
+    unsigned long since = blocked && profile != nullptr
+                          ? profile->Blocking() : 0;
+    while (holder != nullptr && holder != currentThread) {
+#ifdef INVPRIO
+        DonatePriority(holder, currentThread->GetPriority());
+#endif
+        waiters.Append(currentThread);
+        currentThread->waitingOn = this;
+        currentThread->Sleep();
+        currentThread->waitingOn = nullptr;
+    }
     holder = currentThread;
+    nextHeld = currentThread->heldLocks;
+    currentThread->heldLocks = this;
+
+#ifdef INVPRIO
+    // Threads still waiting lend their priority to the new holder.
+    DonatePriority(currentThread, WaiterPriority());
+#endif
+
+    if (profile != nullptr) {
+        profile->operations++;
+        if (blocked)
+            profile->Woken(since);
+        acquiredAt = stats->totalTicks;
+    }
+    interrupt->SetLevel(oldLevel);
 }
 
 void
@@ -146,15 +256,40 @@ Lock::Release()
 {
     ASSERT(IsHeldByCurrentThread());
 
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    Lock **l = &currentThread->heldLocks;
+    while (*l != this)
+        l = &(*l)->nextHeld;
+    *l = nextHeld;
+    nextHeld = nullptr;
+
 #ifdef INVPRIO
-    if (currentThread->GetOldPriority() != currentThread->GetPriority()) {
-      currentThread->SetPriority(currentThread->GetOldPriority());
-      scheduler->UpdatePriority(currentThread);
-    }
+    RestorePriority();
 #endif
 
-    state->V();
-    holder = nullptr;
+    if (profile != nullptr && stats->totalTicks >= acquiredAt)
+        profile->holdTicks += stats->totalTicks - acquiredAt;
+
+    if (waiters.IsEmpty()) {
+        if (convoy > 0 && profile != nullptr)
+            profile->convoys++;
+        convoy = 0;
+        holder = nullptr;
+    } else {
+        convoy++;
+        if (profile != nullptr && convoy > profile->maxConvoy)
+            profile->maxConvoy = convoy;
+
+        Thread *next = NextWaiter();
+        next->waitingOn = nullptr;
+        holder = policy == LOCK_BARGING ? nullptr : next;
+        scheduler->ReadyToRun(next);
+        if (profile != nullptr)
+            profile->wakeups++;
+    }
+
+    interrupt->SetLevel(oldLevel);
 }
 
 bool
@@ -163,19 +298,58 @@ Lock::IsHeldByCurrentThread() const
     return currentThread == holder;
 }
 
+Thread *
+Lock::GetHolder() const
+{
+    return holder;
+}
+
+unsigned
+Lock::WaiterPriority() const
+{
+    unsigned priority = 0;
+    for (Thread *t = waiters.Head(); t != nullptr; t = waiters.Next(t)) {
+        if (t->GetPriority() > priority)
+            priority = t->GetPriority();
+    }
+    return priority;
+}
+
+Thread *
+Lock::NextWaiter()
+{
+    if (policy != LOCK_PRIORITY_HANDOFF)
+        return waiters.Pop();
+
+    Thread *next = waiters.Head();
+    for (Thread *t = waiters.Next(next); t != nullptr; t = waiters.Next(t)) {
+        if (t->GetPriority() > next->GetPriority())
+            next = t;
+    }
+    waiters.Remove(next);
+    return next;
+}
+
 // MARK: Condition variables
+
+/// Condition variables keep their waiters on an intrusive queue, so no
+/// operation allocates memory: `Wait` enqueues the current thread itself
+/// and sleeps, and `Signal` and `Broadcast` move waiters straight to the
+/// ready list.
 Condition::Condition(const char *debugName, Lock *conditionLock)
 {
-  lock = conditionLock;
-  threadsSleeping = 0;
+  ASSERT(conditionLock != nullptr);
+
   name = debugName;
-  sleepQueue = new List<Semaphore *>;
+  lock = conditionLock;
+  profile = synchProfile != nullptr
+            ? synchProfile->Register(CONDITION_KIND, debugName) : nullptr;
 }
 
+/// Assume no one is still waiting on the condition!
 Condition::~Condition()
 {
-    lock = nullptr;
-    delete sleepQueue;
+    ASSERT(waiters.IsEmpty());
 }
 
 const char *
@@ -184,28 +358,90 @@ Condition::GetName() const
     return name;
 }
 
+/// Releasing the lock and going to sleep must be atomic; otherwise a
+/// `Signal` sent in between would be lost.  Hence interrupts are disabled
+/// before enqueuing, and only restored after waking up.
 void
 Condition::Wait()
 {
     ASSERT(lock->IsHeldByCurrentThread());
 
-    // Create a Semaphore to sleep the current thread
-    char *semaphoreName = new char [64];
-    snprintf(semaphoreName, 64, "Condition variable %s Semaphore of Thread %s",
-             GetName(), currentThread->GetName());
-    Semaphore *newSemaphore = new Semaphore(semaphoreName, 0);
-    delete semaphoreName;
-
-    threadsSleeping++;
-    sleepQueue->Append(newSemaphore);
-
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    unsigned long since = 0;
+    if (profile != nullptr) {
+        profile->operations++;
+        since = profile->Blocking();
+    }
+    waiters.Append(currentThread);
     lock->Release();
-    newSemaphore->P();
+    currentThread->Sleep();
+    if (profile != nullptr)
+        profile->Woken(since);
+    interrupt->SetLevel(oldLevel);
 
     // Acquire lock when the thread had woke up
     lock->Acquire();
+}
+
+/// A timed wait in progress, shared with its timeout handler.
+struct TimedWait {
+    Thread *thread;
+    IntrusiveList<Thread, &Thread::queueLink> *waiters;
+    bool fired;     ///< The timeout interrupt has occurred.
+    bool timedOut;  ///< It occurred while the thread was still waiting.
+};
+
+/// If the thread has been signalled but has not run yet, it is ready, and
+/// there is nothing to do: the wait did not time out.
+static void
+WaitTimedOut(void *arg)
+{
+    TimedWait *wait = (TimedWait *) arg;
 
-    delete newSemaphore;
+    wait->fired = true;
+    if (wait->thread->GetStatus() == BLOCKED) {
+        wait->timedOut = true;
+        wait->waiters->Remove(wait->thread);
+        scheduler->ReadyToRun(wait->thread);
+    }
+}
+
+/// The timeout is an interrupt scheduled with the rest, and cancelled if
+/// the thread is signalled first.  The wait record lives on the stack of
+/// the waiting thread, which is safe because the interrupt is either
+/// cancelled or has fired before `WaitFor` returns.
+unsigned long
+Condition::WaitFor(unsigned long ticks)
+{
+    ASSERT(lock->IsHeldByCurrentThread());
+    ASSERT(ticks > 0);
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    unsigned long since = 0;
+    if (profile != nullptr) {
+        profile->operations++;
+        since = profile->Blocking();
+    }
+
+    unsigned long start = stats->totalTicks;
+    TimedWait wait = { currentThread, &waiters, false, false };
+    PendingInterrupt *timeout = interrupt->Schedule(WaitTimedOut, &wait,
+                                                    ticks, TIMEOUT_INT);
+    waiters.Append(currentThread);
+    lock->Release();
+    currentThread->Sleep();
+    if (!wait.fired)
+        interrupt->Cancel(timeout);
+
+    if (profile != nullptr)
+        profile->Woken(since);
+    interrupt->SetLevel(oldLevel);
+
+    lock->Acquire();
+    unsigned long elapsed = stats->totalTicks - start;
+    if (wait.timedOut || elapsed >= ticks)
+        return 0;
+    return ticks - elapsed;
 }
 
 void
@@ -213,11 +449,14 @@ Condition::Signal()
 {
     ASSERT(lock->IsHeldByCurrentThread());
 
-    if (threadsSleeping > 0) {
-      threadsSleeping--;
-      Semaphore *waker = sleepQueue->Pop();
-      waker->V();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Thread *thread = waiters.Pop();
+    if (thread != nullptr) {
+        scheduler->ReadyToRun(thread);
+        if (profile != nullptr)
+            profile->wakeups++;
     }
+    interrupt->SetLevel(oldLevel);
 }
 
 void
@@ -225,27 +464,282 @@ Condition::Broadcast()
 {
     ASSERT(lock->IsHeldByCurrentThread());
 
-    while(threadsSleeping > 0) {
-      Signal();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Thread *thread;
+    while ((thread = waiters.Pop()) != nullptr) {
+        scheduler->ReadyToRun(thread);
+        if (profile != nullptr)
+            profile->wakeups++;
     }
+    interrupt->SetLevel(oldLevel);
+}
+
+// MARK: Readers-writer locks
+
+RWLock::RWLock(const char *debugName, RWLockPolicy lockPolicy)
+{
+    name       = debugName;
+    policy     = lockPolicy;
+    readers    = 0;
+    writer     = nullptr;
+    nextHeld   = nullptr;
+    profile    = synchProfile != nullptr
+                 ? synchProfile->Register(RWLOCK_KIND, debugName) : nullptr;
+    acquiredAt = 0;
+}
+
+RWLock::~RWLock()
+{
+    ASSERT(readers == 0 && writer == nullptr);
+    ASSERT(waitingReaders.IsEmpty() && waitingWriters.IsEmpty());
+}
+
+const char *
+RWLock::GetName() const
+{
+    return name;
+}
+
+void
+RWLock::DonateToWriter()
+{
+#ifdef INVPRIO
+    if (writer != nullptr
+          && DonatePriority(writer, currentThread->GetPriority())
+          && profile != nullptr)
+        profile->donations++;
+#endif
+}
+
+/// Except when readers are preferred, a reader does not overtake a waiting
+/// writer, even if other readers hold the lock.
+void
+RWLock::ReadAcquire()
+{
+    ASSERT(!IsWriteHeldByCurrentThread());
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (profile != nullptr)
+        profile->operations++;
+
+    if (writer != nullptr
+          || (policy != RW_PREFER_READERS && !waitingWriters.IsEmpty())) {
+        DonateToWriter();
+        unsigned long since = profile != nullptr ? profile->Blocking() : 0;
+        waitingReaders.Append(currentThread);
+        currentThread->Sleep();  // Woken up already counted as a reader.
+        if (profile != nullptr)
+            profile->Woken(since);
+    } else
+        readers++;
+
+    interrupt->SetLevel(oldLevel);
+}
+
+void
+RWLock::ReadRelease()
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    ASSERT(readers > 0);
+    if (--readers == 0)
+        Grant(false);
+
+    interrupt->SetLevel(oldLevel);
+}
+
+void
+RWLock::WriteAcquire()
+{
+    ASSERT(!IsWriteHeldByCurrentThread());
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (profile != nullptr)
+        profile->operations++;
+
+    if (writer != nullptr || readers > 0) {
+        DonateToWriter();
+        unsigned long since = profile != nullptr ? profile->Blocking() : 0;
+        waitingWriters.Append(currentThread);
+        currentThread->Sleep();  // Woken up as the writer.
+        ASSERT(writer == currentThread);
+        if (profile != nullptr)
+            profile->Woken(since);
+#ifdef INVPRIO
+        // Threads still waiting lend their priority to the new writer.
+        DonatePriority(currentThread, WaiterPriority());
+#endif
+    } else
+        SetWriter(currentThread);
+
+    if (profile != nullptr)
+        acquiredAt = stats->totalTicks;
+    interrupt->SetLevel(oldLevel);
+}
+
+void
+RWLock::WriteRelease()
+{
+    ASSERT(IsWriteHeldByCurrentThread());
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    RWLock **l = &currentThread->heldRWLocks;
+    while (*l != this)
+        l = &(*l)->nextHeld;
+    *l = nextHeld;
+    nextHeld = nullptr;
+
+#ifdef INVPRIO
+    RestorePriority();
+#endif
+
+    if (profile != nullptr && stats->totalTicks >= acquiredAt)
+        profile->holdTicks += stats->totalTicks - acquiredAt;
+
+    writer = nullptr;
+    Grant(true);
+
+    interrupt->SetLevel(oldLevel);
+}
+
+bool
+RWLock::IsWriteHeldByCurrentThread() const
+{
+    return writer == currentThread;
+}
+
+unsigned
+RWLock::WaiterPriority() const
+{
+    unsigned priority = 0;
+    for (Thread *t = waitingReaders.Head(); t != nullptr;
+         t = waitingReaders.Next(t)) {
+        if (t->GetPriority() > priority)
+            priority = t->GetPriority();
+    }
+    for (Thread *t = waitingWriters.Head(); t != nullptr;
+         t = waitingWriters.Next(t)) {
+        if (t->GetPriority() > priority)
+            priority = t->GetPriority();
+    }
+    return priority;
+}
+
+void
+RWLock::SetWriter(Thread *thread)
+{
+    writer = thread;
+    nextHeld = thread->heldRWLocks;
+    thread->heldRWLocks = this;
+}
+
+/// Under the fair policy, readers go first after a writer and a writer goes
+/// first after readers, so that phases alternate.
+void
+RWLock::Grant(bool afterWriter)
+{
+    bool readersFirst = policy == RW_PREFER_READERS
+                        || (policy == RW_FAIR && afterWriter);
+
+    if (readersFirst && !waitingReaders.IsEmpty())
+        GrantReaders();
+    else if (!waitingWriters.IsEmpty())
+        GrantWriter();
+    else
+        GrantReaders();
+}
+
+void
+RWLock::GrantReaders()
+{
+    Thread *thread;
+    while ((thread = waitingReaders.Pop()) != nullptr) {
+        readers++;
+        scheduler->ReadyToRun(thread);
+        if (profile != nullptr)
+            profile->wakeups++;
+    }
+}
+
+void
+RWLock::GrantWriter()
+{
+    Thread *thread = waitingWriters.Pop();
+    ASSERT(thread != nullptr);
+    SetWriter(thread);
+    scheduler->ReadyToRun(thread);
+    if (profile != nullptr)
+        profile->wakeups++;
+}
+
+// MARK: Barriers
+
+Barrier::Barrier(const char *debugName, unsigned numParties)
+{
+    ASSERT(numParties > 0);
+
+    name    = debugName;
+    parties = numParties;
+    arrived = 0;
+    profile = synchProfile != nullptr
+              ? synchProfile->Register(BARRIER_KIND, debugName) : nullptr;
+}
+
+Barrier::~Barrier()
+{
+    ASSERT(waiters.IsEmpty());
+}
+
+const char *
+Barrier::GetName() const
+{
+    return name;
+}
+
+/// The count is reset before the waiters are woken up, so that any of them
+/// can arrive for the next round straight away.
+bool
+Barrier::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (profile != nullptr)
+        profile->operations++;
+
+    bool last = ++arrived == parties;
+    if (last) {
+        arrived = 0;
+        Thread *thread;
+        while ((thread = waiters.Pop()) != nullptr) {
+            scheduler->ReadyToRun(thread);
+            if (profile != nullptr)
+                profile->wakeups++;
+        }
+    } else {
+        unsigned long since = profile != nullptr ? profile->Blocking() : 0;
+        waiters.Append(currentThread);
+        currentThread->Sleep();
+        if (profile != nullptr)
+            profile->Woken(since);
+    }
+
+    interrupt->SetLevel(oldLevel);
+    return last;
 }
 
 // MARK: Channel
 
 Channel::Channel(const char *debugName)
 {
+  name = debugName;
   lock = new Lock(debugName);
 
-  char *conditionName = new char [64];
-  snprintf(conditionName, 64, "Senders condition %s", debugName);
-  senders = new Condition(conditionName, lock);
-
-  snprintf(conditionName, 64, "Receivers condition %s", debugName);
-  receivers = new Condition(conditionName, lock);
-
-  buffer = new List<int>;
+  // The conditions share the channel's name: they keep a pointer to it, so
+  // it must outlive them.
+  senders = new Condition(debugName, lock);
+  receivers = new Condition(debugName, lock);
 
-  delete conditionName;
+  buffer = new PooledList<int>;
 }
 
 
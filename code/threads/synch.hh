@@ -20,8 +20,10 @@
 #define NACHOS_THREADS_SYNCH__HH
 
 
+#include "synch_profile.hh"
 #include "thread.hh"
-#include "lib/list.hh"
+#include "lib/intrusive_list.hh"
+#include "lib/pooled_list.hh"
 
 
 /// This class defines a “semaphore”, which has a positive integer as its
@@ -41,8 +43,10 @@ public:
 
     /// Constructor: give an initial value to the semaphore.
     ///
-    /// Set initial value.
-    Semaphore(const char *debugName, int initialValue);
+    /// Set initial value.  Semaphores used inside other synchronization
+    /// objects pass `profiled = false`, so that they are not counted twice
+    /// by the contention profiler.
+    Semaphore(const char *debugName, int initialValue, bool profiled = true);
 
     ~Semaphore();
 
@@ -64,7 +68,13 @@ private:
     int value;
 
     /// Queue of threads waiting on `P` because the value is zero.
-    List<Thread *> *queue;
+    ///
+    /// Threads are linked through `Thread::queueLink`, so waiting does not
+    /// allocate memory.
+    IntrusiveList<Thread, &Thread::queueLink> queue;
+
+    /// Contention counters; null unless profiling.
+    SynchRecord *profile;
 
 };
 
@@ -79,11 +89,35 @@ private:
 ///
 /// For convenience, nobody but the thread that holds the lock can free it.
 /// There is no operation for reading the state of the lock.
+///
+/// What happens to a lock released while threads wait for it depends on
+/// its policy:
+///
+/// * `LOCK_BARGING` -- the lock is freed, and the first waiter woken up to
+///   compete for it again; any thread may take it meanwhile.  Before
+///   blocking, a thread yields a few times while the holder is ready to
+///   run, as it may release the lock soon.  This keeps the lock busy, but
+///   a waiter can be overtaken any number of times.
+/// * `LOCK_FIFO_HANDOFF` -- the lock passes straight to the first waiter,
+///   in order of arrival.
+/// * `LOCK_PRIORITY_HANDOFF` -- the lock passes straight to the waiter of
+///   highest priority, the first one among equals.
+///
+/// Handing the lock off is fair, but the releasing thread has to wait for
+/// every thread queued before it if it wants the lock again: a convoy.  The
+/// contention profile records the length of convoys, counted as releases in
+/// a row that find some thread waiting.
+enum LockPolicy {
+    LOCK_BARGING,
+    LOCK_FIFO_HANDOFF,
+    LOCK_PRIORITY_HANDOFF
+};
+
 class Lock {
 public:
 
     /// Constructor: set up the lock as free.
-    Lock(const char *debugName);
+    Lock(const char *debugName, LockPolicy lockPolicy = LOCK_BARGING);
 
     ~Lock();
 
@@ -102,14 +136,38 @@ public:
     /// Useful for checks in `Release` and in condition variables.
     bool IsHeldByCurrentThread() const;
 
+    /// Thread holding the lock, or null.
+    Thread *GetHolder() const;
+
+    /// Highest priority among the threads waiting for the lock, or 0.
+    unsigned WaiterPriority() const;
+
+    /// Next lock held by the same thread; see `Thread::heldLocks`.
+    Lock *nextHeld;
+
 private:
 
+    /// Remove and return the waiter the lock goes to.
+    Thread *NextWaiter();
+
     /// For debugging.
     const char *name;
 
-    // Add other needed fields here.
-    Semaphore *state;
+    LockPolicy policy;
+
     Thread *holder;
+
+    /// Threads blocked in `Acquire`, linked through `Thread::queueLink`.
+    IntrusiveList<Thread, &Thread::queueLink> waiters;
+
+    /// Releases in a row that found threads waiting.
+    unsigned convoy;
+
+    /// Contention counters; null unless profiling.
+    SynchRecord *profile;
+
+    /// Time of the last acquisition, to measure hold times.
+    unsigned long acquiredAt;
 };
 
 // This class defined a “condition variable”.
@@ -163,14 +221,152 @@ public:
     void Signal();
     void Broadcast();
 
+    /// Like `Wait`, but give up waiting after `ticks` ticks of simulated
+    /// time.
+    ///
+    /// Returns how many of the `ticks` are left, which is 0 if it timed
+    /// out; in both cases the lock is held again on return.
+    unsigned long WaitFor(unsigned long ticks);
+
 private:
 
     const char *name;
 
-    // Other needed fields are to be added here.
     Lock *lock;
-    int threadsSleeping;
-    List<Semaphore *> *sleepQueue;
+
+    /// Threads blocked in `Wait`, linked through `Thread::queueLink`.
+    IntrusiveList<Thread, &Thread::queueLink> waiters;
+
+    /// Contention counters; null unless profiling.
+    SynchRecord *profile;
+};
+
+/// Policies of a readers-writer lock.
+enum RWLockPolicy {
+    /// Phase fair: readers arriving while a writer waits queue behind it,
+    /// and a releasing writer admits every waiting reader at once, so that
+    /// batches of readers and single writers alternate and neither starves.
+    RW_FAIR,
+
+    /// Readers get in whenever no writer holds the lock, and are admitted
+    /// first when one releases it.  Best read throughput, but writers can
+    /// starve.
+    RW_PREFER_READERS,
+
+    /// Readers wait while any writer waits, and a releasing writer hands
+    /// the lock to the next writer.  Readers can starve.
+    RW_PREFER_WRITERS
+};
+
+/// This class defines a “readers-writer lock”: many threads may hold it at
+/// once to read, or a single one to write.
+///
+/// Waiting threads are queued through `Thread::queueLink`, so no operation
+/// allocates memory.  A thread is only woken up once the lock has been
+/// granted to it, so it never has to compete again for it.
+///
+/// As with `Lock`, a thread that blocks donates its priority to the holder,
+/// but only to a writer: the readers holding the lock are not recorded.
+class RWLock {
+public:
+
+    RWLock(const char *debugName, RWLockPolicy lockPolicy = RW_FAIR);
+
+    ~RWLock();
+
+    const char *GetName() const;
+
+    /// Acquire the lock for reading, or release a read acquisition.
+    void ReadAcquire();
+    void ReadRelease();
+
+    /// Acquire the lock for writing, or release it.
+    void WriteAcquire();
+    void WriteRelease();
+
+    /// Does the current thread hold the lock for writing?
+    bool IsWriteHeldByCurrentThread() const;
+
+    /// Highest priority among the threads waiting for the lock, or 0.
+    unsigned WaiterPriority() const;
+
+    /// Next lock held for writing by the same thread; see
+    /// `Thread::heldRWLocks`.
+    RWLock *nextHeld;
+
+private:
+
+    /// Make `thread` the writer, and add the lock to those it holds.
+    void SetWriter(Thread *thread);
+
+    /// Hand the free lock over to the next waiters, as the policy says.
+    ///
+    /// * `afterWriter` tells whether a writer or the last reader has just
+    ///   released it.
+    void Grant(bool afterWriter);
+
+    /// Let every waiting reader in.
+    void GrantReaders();
+
+    /// Let the first waiting writer in.
+    void GrantWriter();
+
+    /// Lend the priority of the current thread, which is about to block, to
+    /// the writer holding the lock, if it has a lower one.
+    void DonateToWriter();
+
+    const char *name;
+    RWLockPolicy policy;
+
+    /// Number of threads holding the lock for reading.
+    unsigned readers;
+
+    /// Thread holding the lock for writing, if any.
+    Thread *writer;
+
+    IntrusiveList<Thread, &Thread::queueLink> waitingReaders;
+    IntrusiveList<Thread, &Thread::queueLink> waitingWriters;
+
+    /// Contention counters; null unless profiling.
+    SynchRecord *profile;
+
+    /// Time of the last write acquisition, to measure hold times.
+    unsigned long acquiredAt;
+};
+
+/// This class defines a reusable “barrier”: each of a fixed number of
+/// threads waits at it until all of them have arrived, and then all go on,
+/// leaving the barrier ready for the next round.
+class Barrier {
+public:
+
+    /// * `numParties` is the number of threads that meet at the barrier.
+    Barrier(const char *debugName, unsigned numParties);
+
+    ~Barrier();
+
+    const char *GetName() const;
+
+    /// Wait until `numParties` threads have called `Wait` in this round.
+    ///
+    /// Returns true in exactly one of them, the last to arrive, so that it
+    /// can do any work that needs to be done once per round.
+    bool Wait();
+
+private:
+
+    const char *name;
+
+    unsigned parties;
+
+    /// Threads that have arrived in this round.
+    unsigned arrived;
+
+    /// Threads blocked in `Wait`, linked through `Thread::queueLink`.
+    IntrusiveList<Thread, &Thread::queueLink> waiters;
+
+    /// Contention counters; null unless profiling.
+    SynchRecord *profile;
 };
 
 class Channel {
@@ -190,7 +386,7 @@ private:
   const char *name;
 
   Lock *lock;
-  List<int> *buffer;
+  PooledList<int> *buffer;
   Condition *senders;
   Condition *receivers;
 };
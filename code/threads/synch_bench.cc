@@ -0,0 +1,671 @@
+/// Microbenchmark for the synchronization primitives.
+///
+/// Each test runs a fixed number of operations on a primitive, usually with
+/// other threads on the other side, and reports the heap allocations,
+/// simulated ticks and host time per operation.  Allocations are counted by
+/// replacing the global `operator new`; the objects under test and the
+/// helper threads are created while counting is suspended, and every test
+/// is run once to warm up before being measured.
+///
+/// Allocations and ticks are deterministic.  Host time is not, so each test
+/// is measured several times and the median is reported.
+///
+/// With `-tb tsv`, results are printed as tab separated values instead of a
+/// table, for scripts that compare runs: a header line, and then a line per
+/// test with its name, the number of threads taking part, the iterations,
+/// and the allocations, ticks and nanoseconds per operation.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "bounded_channel.hh"
+#include "synch.hh"
+#include "synch_list.hh"
+#include "system.hh"
+
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+static unsigned long allocations = 0;
+static bool counting = false;
+
+void *
+operator new(size_t size)
+{
+    if (counting)
+        allocations++;
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *
+operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+
+static const unsigned WARMUP_OPERATIONS = 100;
+static const unsigned OPERATIONS = 1000;
+
+/// Measured runs of each test; the host time reported is their median.
+static const unsigned REPETITIONS = 5;
+
+static Semaphore *done;
+static Semaphore *ping;
+static Semaphore *pong;
+static Lock *lock;
+static Lock *fifoLock;
+static Lock *priorityLock;
+static Lock *contendedLock;  ///< One of the above, for `LockLoop`.
+static Condition *turnChanged;
+static Condition *roundStarted;
+static Condition *allArrived;
+static unsigned round;
+static unsigned arrivals;
+static RWLock *rwLock;
+static Barrier *barrier;
+static int turn;
+static SynchList<int> *synchList;
+static Channel *channel;
+static BoundedChannel<int> *boundedChannel;
+
+/// Capacity of `boundedChannel`, and size of the batches of the batch
+/// tests.
+static const unsigned BATCH_SIZE = 16;
+
+/// Threads taking part in the test being run, for those that take a
+/// variable number of them.
+static unsigned parties;
+
+/// Fork a helper thread, without counting its allocations.
+static void
+Spawn(const char *name, VoidFunctionPtr func, unsigned n)
+{
+    bool wasCounting = counting;
+    counting = false;
+    Thread *t = new Thread(name);
+    t->Fork(func, (void *) (uintptr_t) n);
+    counting = wasCounting;
+}
+
+static unsigned
+Operations(void *n_)
+{
+    return (unsigned) (uintptr_t) n_;
+}
+
+static void
+SemaphoreSingle(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        ping->V();
+        ping->P();
+    }
+}
+
+static void
+PongThread(void *n_)
+{
+    for (unsigned i = 0, n = Operations(n_); i < n; i++) {
+        ping->P();
+        pong->V();
+    }
+    done->V();
+}
+
+static void
+SemaphorePingPong(unsigned n)
+{
+    Spawn("pong", PongThread, n);
+    for (unsigned i = 0; i < n; i++) {
+        ping->V();
+        pong->P();
+    }
+    done->P();
+}
+
+static void
+LockSingle(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        lock->Acquire();
+        lock->Release();
+    }
+}
+
+static void
+LockLoop(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        contendedLock->Acquire();
+        currentThread->Yield();  // Make the other thread block on the lock.
+        contendedLock->Release();
+    }
+}
+
+static void
+LockThread(void *n_)
+{
+    LockLoop(Operations(n_));
+    done->V();
+}
+
+static void
+LockContended(unsigned n)
+{
+    for (unsigned i = 1; i < parties; i++)
+        Spawn("lock contender", LockThread, n);
+    LockLoop(n);
+    for (unsigned i = 1; i < parties; i++)
+        done->P();
+}
+
+static void
+BargingContended(unsigned n)
+{
+    contendedLock = lock;
+    LockContended(n);
+}
+
+static void
+FifoContended(unsigned n)
+{
+    contendedLock = fifoLock;
+    LockContended(n);
+}
+
+static void
+PriorityContended(unsigned n)
+{
+    contendedLock = priorityLock;
+    LockContended(n);
+}
+
+static void
+ReadSingle(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        rwLock->ReadAcquire();
+        rwLock->ReadRelease();
+    }
+}
+
+static void
+ReadLoop(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        rwLock->ReadAcquire();
+        currentThread->Yield();  // The other reader gets in all the same.
+        rwLock->ReadRelease();
+    }
+}
+
+static void
+ReadThread(void *n_)
+{
+    ReadLoop(Operations(n_));
+    done->V();
+}
+
+/// Like `LockContended`, but both threads only read.
+static void
+ReadShared(unsigned n)
+{
+    Spawn("reader", ReadThread, n);
+    ReadLoop(n);
+    done->P();
+}
+
+static void
+BarrierThread(void *n_)
+{
+    for (unsigned i = 0, n = Operations(n_); i < n; i++)
+        barrier->Wait();
+    done->V();
+}
+
+static void
+BarrierRounds(unsigned n)
+{
+    Spawn("barrier party", BarrierThread, n);
+    for (unsigned i = 0; i < n; i++)
+        barrier->Wait();
+    done->P();
+}
+
+static void
+TurnLoop(unsigned n, int me)
+{
+    for (unsigned i = 0; i < n; i++) {
+        lock->Acquire();
+        while (turn != me)
+            turnChanged->Wait();
+        turn = 1 - me;
+        turnChanged->Signal();
+        lock->Release();
+    }
+}
+
+static void
+TurnThread(void *n_)
+{
+    TurnLoop(Operations(n_), 1);
+    done->V();
+}
+
+static void
+ConditionPingPong(unsigned n)
+{
+    turn = 0;
+    Spawn("turn taker", TurnThread, n);
+    TurnLoop(n, 0);
+    done->P();
+}
+
+/// Every round, wake up all the other threads at once, and wait for all of
+/// them to notice.
+static void
+StormThread(void *n_)
+{
+    unsigned seen = 0;
+    for (unsigned i = 0, n = Operations(n_); i < n; i++) {
+        lock->Acquire();
+        while (round == seen)
+            roundStarted->Wait();
+        seen = round;
+        if (++arrivals == parties - 1)
+            allArrived->Signal();
+        lock->Release();
+    }
+    done->V();
+}
+
+static void
+BroadcastStorm(unsigned n)
+{
+    round = 0;
+    for (unsigned i = 1; i < parties; i++)
+        Spawn("storm waiter", StormThread, n);
+
+    for (unsigned i = 0; i < n; i++) {
+        lock->Acquire();
+        arrivals = 0;
+        round++;
+        roundStarted->Broadcast();
+        while (arrivals < parties - 1)
+            allArrived->Wait();
+        lock->Release();
+    }
+    for (unsigned i = 1; i < parties; i++)
+        done->P();
+}
+
+static void
+ProducerThread(void *n_)
+{
+    for (unsigned i = 0, n = Operations(n_); i < n; i++)
+        synchList->Append(i);
+    done->V();
+}
+
+/// One consumer for all the other threads, which produce.
+static void
+SynchListTransfer(unsigned n)
+{
+    for (unsigned i = 1; i < parties; i++)
+        Spawn("producer", ProducerThread, n);
+    for (unsigned i = 0; i < n * (parties - 1); i++)
+        synchList->Pop();
+    for (unsigned i = 1; i < parties; i++)
+        done->P();
+}
+
+/// Like `ProducerThread`, but yield after every item, so that the consumer
+/// finds the list empty and has to wait each time.
+static void
+HandoffThread(void *n_)
+{
+    for (unsigned i = 0, n = Operations(n_); i < n; i++) {
+        synchList->Append(i);
+        currentThread->Yield();
+    }
+    done->V();
+}
+
+static void
+SynchListHandoff(unsigned n)
+{
+    Spawn("producer", HandoffThread, n);
+    for (unsigned i = 0; i < n; i++)
+        synchList->Pop();
+    done->P();
+}
+
+static void
+BatchProducerThread(void *n_)
+{
+    int batch[BATCH_SIZE];
+    for (unsigned i = 0; i < BATCH_SIZE; i++)
+        batch[i] = i;
+
+    for (unsigned sent = 0, n = Operations(n_); sent < n; ) {
+        unsigned count = n - sent < BATCH_SIZE ? n - sent : BATCH_SIZE;
+        synchList->AppendMany(batch, count);
+        sent += count;
+    }
+    done->V();
+}
+
+static void
+SynchListBatch(unsigned n)
+{
+    Spawn("batch producer", BatchProducerThread, n);
+    int batch[BATCH_SIZE];
+    for (unsigned received = 0; received < n; )
+        received += synchList->PopUpTo(batch, BATCH_SIZE);
+    done->P();
+}
+
+static void
+SenderThread(void *n_)
+{
+    for (unsigned i = 0, n = Operations(n_); i < n; i++)
+        channel->Send(i);
+    done->V();
+}
+
+static void
+ChannelTransfer(unsigned n)
+{
+    Spawn("sender", SenderThread, n);
+    for (unsigned i = 0; i < n; i++) {
+        int message;
+        channel->Receive(&message);
+    }
+    done->P();
+}
+
+static void
+BoundedSenderThread(void *n_)
+{
+    for (unsigned i = 0, n = Operations(n_); i < n; i++)
+        boundedChannel->Send(i);
+    done->V();
+}
+
+static void
+BoundedChannelTransfer(unsigned n)
+{
+    Spawn("sender", BoundedSenderThread, n);
+    for (unsigned i = 0; i < n; i++) {
+        int message;
+        boundedChannel->Receive(&message);
+    }
+    done->P();
+}
+
+static void
+BatchSenderThread(void *n_)
+{
+    int batch[BATCH_SIZE];
+    for (unsigned i = 0; i < BATCH_SIZE; i++)
+        batch[i] = i;
+
+    for (unsigned sent = 0, n = Operations(n_); sent < n; ) {
+        unsigned count = n - sent < BATCH_SIZE ? n - sent : BATCH_SIZE;
+        boundedChannel->SendMany(batch, count);
+        sent += count;
+    }
+    done->V();
+}
+
+static void
+BoundedChannelBatch(unsigned n)
+{
+    Spawn("batch sender", BatchSenderThread, n);
+    int batch[BATCH_SIZE];
+    for (unsigned received = 0; received < n; )
+        received += boundedChannel->ReceiveMany(batch, BATCH_SIZE);
+    done->P();
+}
+
+static void
+ShortLivedThread(void *)
+{
+    done->V();
+}
+
+/// Fork a thread per operation, as a thread-per-request server would.
+static void
+ThreadForkFinish(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        Thread *t = new Thread("short lived");
+        t->Fork(ShortLivedThread, nullptr);
+        done->P();
+    }
+}
+
+static void
+JoinedThread(void *)
+{}
+
+/// Like `ThreadForkFinish`, but wait for each thread with `Join`.
+static void
+ThreadForkJoin(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        Thread *t = new Thread("joined", true);
+        t->Fork(JoinedThread, nullptr);
+        t->Join();
+    }
+}
+
+/// Context switch costs, by component.  A yield with nothing else ready
+/// only goes through the scheduler; with a second thread yielding back,
+/// every yield also switches, with either switch routine.  The difference
+/// between the two is the cost of the registers that `SWITCH_LIGHT` does
+/// not save.
+
+static void
+YieldAlone(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+        currentThread->Yield();
+}
+
+static void
+YieldThread(void *n_)
+{
+    YieldAlone(Operations(n_));
+    done->V();
+}
+
+static void
+YieldPingPong(unsigned n)
+{
+    Spawn("yielder", YieldThread, n);
+    YieldAlone(n);
+    done->P();
+}
+
+static void
+YieldLightSwitch(unsigned n)
+{
+    scheduler->SetLightSwitch(true);
+    YieldPingPong(n);
+}
+
+static void
+YieldFullSwitch(unsigned n)
+{
+    scheduler->SetLightSwitch(false);
+    YieldPingPong(n);
+    scheduler->SetLightSwitch(true);
+}
+
+#ifdef USER_PROGRAM
+/// The copy of user registers that a switch between user threads needs,
+/// and that one to a kernel thread and back no longer does.
+static void
+UserStateCopy(unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        currentThread->SaveUserState();
+        currentThread->RestoreUserState();
+    }
+}
+#endif
+
+struct Benchmark {
+    const char *name;
+    void (*run)(unsigned n);
+
+    /// Threads taking part, including the main one.
+    unsigned threads;
+
+    /// Operations counted per iteration, by all the threads together.
+    unsigned operationsPerIteration;
+};
+
+static const Benchmark BENCHMARKS[] = {
+    { "semaphore V/P",         SemaphoreSingle,         1,  2 },
+    { "semaphore ping-pong",   SemaphorePingPong,       2,  2 },
+    { "lock acquire/release",  LockSingle,              1,  2 },
+    { "lock contended",        BargingContended,        2,  4 },
+    { "lock contended",        BargingContended,        4,  8 },
+    { "lock contended",        BargingContended,        8, 16 },
+    { "lock fifo handoff",     FifoContended,           2,  4 },
+    { "lock fifo handoff",     FifoContended,           4,  8 },
+    { "lock fifo handoff",     FifoContended,           8, 16 },
+    { "lock priority handoff", PriorityContended,       2,  4 },
+    { "lock priority handoff", PriorityContended,       8, 16 },
+    { "condition ping-pong",   ConditionPingPong,       2,  2 },
+    { "condition broadcast",   BroadcastStorm,          5,  4 },
+    { "condition broadcast",   BroadcastStorm,         17, 16 },
+    { "rwlock read",           ReadSingle,              1,  2 },
+    { "rwlock shared read",    ReadShared,              2,  4 },
+    { "barrier rounds",        BarrierRounds,           2,  2 },
+    { "synch list transfer",   SynchListTransfer,       2,  2 },
+    { "synch list transfer",   SynchListTransfer,       5,  8 },
+    { "synch list handoff",    SynchListHandoff,        2,  2 },
+    { "synch list batch",      SynchListBatch,          2,  2 },
+    { "channel transfer",      ChannelTransfer,         2,  2 },
+    { "bounded channel",       BoundedChannelTransfer,  2,  2 },
+    { "bounded channel batch", BoundedChannelBatch,     2,  2 },
+    { "thread fork/finish",    ThreadForkFinish,        2,  1 },
+    { "thread fork/join",      ThreadForkJoin,          2,  1 },
+    { "yield alone",           YieldAlone,              1,  1 },
+    { "yield light switch",    YieldLightSwitch,        2,  2 },
+    { "yield full switch",     YieldFullSwitch,         2,  2 },
+#ifdef USER_PROGRAM
+    { "user state save/restore", UserStateCopy,         1,  1 },
+#endif
+};
+
+static int
+CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+/// Run every benchmark and print the results, as a table or, if `tsv`,
+/// as tab separated values.
+void
+SynchBenchmark(bool tsv)
+{
+    done           = new Semaphore("bench done", 0);
+    ping           = new Semaphore("bench ping", 0);
+    pong           = new Semaphore("bench pong", 0);
+    lock           = new Lock("bench lock");
+    fifoLock       = new Lock("bench fifo lock", LOCK_FIFO_HANDOFF);
+    priorityLock   = new Lock("bench priority lock", LOCK_PRIORITY_HANDOFF);
+    turnChanged    = new Condition("bench turn", lock);
+    roundStarted   = new Condition("bench round", lock);
+    allArrived     = new Condition("bench arrivals", lock);
+    rwLock         = new RWLock("bench rwlock");
+    barrier        = new Barrier("bench barrier", 2);
+    synchList      = new SynchList<int>;
+    channel        = new Channel("bench channel");
+    boundedChannel = new BoundedChannel<int>("bench bounded", BATCH_SIZE);
+
+    if (tsv)
+        printf("test\tthreads\titerations\tallocs/op\tticks/op\tns/op\n");
+    else {
+        printf("Synchronization benchmark, %u iterations per test, "
+               "median of %u runs:\n", OPERATIONS, REPETITIONS);
+        printf("%-24s %7s %10s %10s %10s\n", "test", "threads",
+               "allocs/op", "ticks/op", "ns/op");
+    }
+
+    for (const Benchmark &b : BENCHMARKS) {
+        parties = b.threads;
+        b.run(WARMUP_OPERATIONS);
+
+        double ops = (double) OPERATIONS * b.operationsPerIteration;
+        double allocsPerOp = 0, ticksPerOp = 0;
+        double nsPerOp[REPETITIONS];
+        for (unsigned r = 0; r < REPETITIONS; r++) {
+            unsigned long startAllocations = allocations;
+            unsigned long startTicks = stats->totalTicks;
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            counting = true;
+            b.run(OPERATIONS);
+            counting = false;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            allocsPerOp = (allocations - startAllocations) / ops;
+            ticksPerOp  = (stats->totalTicks - startTicks) / ops;
+            nsPerOp[r]  = ((end.tv_sec - start.tv_sec) * 1e9
+                           + (end.tv_nsec - start.tv_nsec)) / ops;
+        }
+        qsort(nsPerOp, REPETITIONS, sizeof *nsPerOp, CompareDoubles);
+        double ns = nsPerOp[REPETITIONS / 2];
+
+        if (tsv)
+            printf("%s\t%u\t%u\t%.2f\t%.2f\t%.1f\n", b.name, b.threads,
+                   OPERATIONS, allocsPerOp, ticksPerOp, ns);
+        else
+            printf("%-24s %7u %10.2f %10.2f %10.1f\n", b.name, b.threads,
+                   allocsPerOp, ticksPerOp, ns);
+    }
+
+    delete boundedChannel;
+    delete channel;
+    delete synchList;
+    delete barrier;
+    delete rwLock;
+    delete allArrived;
+    delete roundStarted;
+    delete turnChanged;
+    delete priorityLock;
+    delete fifoLock;
+    delete lock;
+    delete pong;
+    delete ping;
+    delete done;
+}
@@ -1,7 +1,7 @@
 /// Data structures for synchronized access to a list.
 ///
-/// Implemented by surrounding the `List` abstraction with synchronization
-/// routines.
+/// Implemented by surrounding the `PooledList` abstraction with
+/// synchronization routines.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2020 Docentes de la Universidad Nacional de Rosario.
@@ -13,7 +13,7 @@
 
 
 #include "synch.hh"
-#include "lib/list.hh"
+#include "lib/pooled_list.hh"
 
 
 /// The following class defines a "synchronized list" -- a list for which
@@ -36,17 +36,36 @@ public:
     /// remove.
     void Append(Item item);
 
+    /// Append the `count` items of `items`, in order, under a single
+    /// acquisition of the lock.
+    void AppendMany(const Item *items, unsigned count);
+
     /// Remove the first item from the front of the list, waiting if the list
     /// is empty.
     Item Pop();
 
+    /// Like `Pop`, but wait at most `timeout` ticks.
+    ///
+    /// Returns false, leaving `item` untouched, if the list was still empty
+    /// by then.
+    bool Pop(Item *item, unsigned long timeout);
+
+    /// Remove between 1 and `max` items from the front of the list into
+    /// `items`, waiting only while the list is empty.
+    ///
+    /// Returns how many items were removed.
+    unsigned PopUpTo(Item *items, unsigned max);
+
+    /// Like `Pop`, but return false instead of waiting if the list is empty.
+    bool TryPop(Item *item);
+
     /// Apply function to every item in the list.
     void Apply(void (*func)(Item));
 
 private:
 
     // The unsynchronized list.
-    List<Item> *list;
+    PooledList<Item> *list;
 
     // Enforce mutual exclusive access to the list.
     Lock *lock;
@@ -63,7 +82,7 @@ private:
 template <class Item>
 SynchList<Item>::SynchList()
 {
-    list      = new List<Item>;
+    list      = new PooledList<Item>;
     lock      = new Lock("list lock");
     listEmpty = new Condition("list empty cond", lock);
     // original // listEmpty = new Condition("list empty cond");
@@ -113,6 +132,77 @@ SynchList<Item>::Pop()
     return item;
 }
 
+/// A single item only needs a single consumer, but a batch may satisfy
+/// several of them.
+template <class Item>
+void
+SynchList<Item>::AppendMany(const Item *items, unsigned count)
+{
+    ASSERT(items != nullptr || count == 0);
+
+    if (count == 0)
+        return;
+
+    lock->Acquire();
+    for (unsigned i = 0; i < count; i++)
+        list->Append(items[i]);
+    if (count == 1)
+        listEmpty->Signal();
+    else
+        listEmpty->Broadcast();
+    lock->Release();
+}
+
+/// Waking up does not mean the list has an item: another consumer may have
+/// taken it first, so the wait is resumed for whatever is left of the
+/// timeout.
+template <class Item>
+bool
+SynchList<Item>::Pop(Item *item, unsigned long timeout)
+{
+    ASSERT(item != nullptr);
+
+    lock->Acquire();
+    while (list->IsEmpty() && timeout > 0)
+        timeout = listEmpty->WaitFor(timeout);
+    bool popped = !list->IsEmpty();
+    if (popped)
+        *item = list->Pop();
+    lock->Release();
+    return popped;
+}
+
+template <class Item>
+unsigned
+SynchList<Item>::PopUpTo(Item *items, unsigned max)
+{
+    ASSERT(items != nullptr);
+    ASSERT(max > 0);
+
+    lock->Acquire();
+    while (list->IsEmpty())
+        listEmpty->Wait();
+    unsigned popped = 0;
+    for (; popped < max && !list->IsEmpty(); popped++)
+        items[popped] = list->Pop();
+    lock->Release();
+    return popped;
+}
+
+template <class Item>
+bool
+SynchList<Item>::TryPop(Item *item)
+{
+    ASSERT(item != nullptr);
+
+    lock->Acquire();
+    bool popped = !list->IsEmpty();
+    if (popped)
+        *item = list->Pop();
+    lock->Release();
+    return popped;
+}
+
 /// Apply function to every item on the list.
 ///
 /// Obey mutual exclusion constraints.
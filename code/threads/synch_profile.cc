@@ -0,0 +1,158 @@
+/// Routines to gather and report synchronization contention.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "synch_profile.hh"
+#include "system.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const char *const KIND_NAMES[] = {
+    "semaphore", "lock", "condition", "rwlock", "barrier"
+};
+
+unsigned long
+SynchRecord::Blocking()
+{
+    waiting++;
+    if (waiting > maxWaiting)
+        maxWaiting = waiting;
+    contended++;
+    return stats->totalTicks;
+}
+
+/// If the tick counter was restarted meanwhile, the wait is not counted.
+void
+SynchRecord::Woken(unsigned long since)
+{
+    ASSERT(waiting > 0);
+
+    waiting--;
+    if (stats->totalTicks < since)
+        return;
+    unsigned long ticks = stats->totalTicks - since;
+    waitTicks += ticks;
+    if (ticks > maxWaitTicks)
+        maxWaitTicks = ticks;
+}
+
+static unsigned
+Hash(SynchKind kind, const char *name)
+{
+    unsigned h = 5381 + kind;
+    for (; *name != '\0'; name++)
+        h = h * 33 + (unsigned char) *name;
+    return h;
+}
+
+SynchProfile::SynchProfile()
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++)
+        buckets[i] = nullptr;
+    numRecords = 0;
+}
+
+SynchProfile::~SynchProfile()
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        while (buckets[i] != nullptr) {
+            SynchRecord *r = buckets[i];
+            buckets[i] = r->next;
+            delete [] r->name;
+            delete r;
+        }
+    }
+}
+
+/// Interrupts are disabled so that a preempting thread cannot register an
+/// object at the same time.
+SynchRecord *
+SynchProfile::Register(SynchKind kind, const char *name)
+{
+    ASSERT(kind < NUM_SYNCH_KINDS);
+
+    if (name == nullptr)
+        name = "(unnamed)";
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    SynchRecord **bucket = &buckets[Hash(kind, name) % NUM_BUCKETS];
+    SynchRecord *r;
+    for (r = *bucket; r != nullptr; r = r->next) {
+        if (r->kind == kind && !strcmp(r->name, name))
+            break;
+    }
+
+    if (r == nullptr) {
+        r = new SynchRecord;
+        memset(r, 0, sizeof *r);
+        r->kind = kind;
+        r->name = new char [strlen(name) + 1];
+        strcpy(r->name, name);
+        r->next = *bucket;
+        *bucket = r;
+        numRecords++;
+    }
+    r->instances++;
+
+    interrupt->SetLevel(oldLevel);
+    return r;
+}
+
+static int
+MoreContended(const void *a, const void *b)
+{
+    const SynchRecord *x = *(const SynchRecord *const *) a;
+    const SynchRecord *y = *(const SynchRecord *const *) b;
+
+    if (x->contended != y->contended)
+        return x->contended > y->contended ? -1 : 1;
+    if (x->waitTicks != y->waitTicks)
+        return x->waitTicks > y->waitTicks ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+void
+SynchProfile::Print(unsigned top) const
+{
+    SynchRecord **sorted = new SynchRecord *[numRecords + 1];
+    unsigned n = 0;
+    unsigned long ops[NUM_SYNCH_KINDS]     = { 0 };
+    unsigned long blocked[NUM_SYNCH_KINDS] = { 0 };
+    unsigned long waited[NUM_SYNCH_KINDS]  = { 0 };
+
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        for (SynchRecord *r = buckets[i]; r != nullptr; r = r->next) {
+            ops[r->kind]     += r->operations;
+            blocked[r->kind] += r->contended;
+            waited[r->kind]  += r->waitTicks;
+            if (r->contended > 0)
+                sorted[n++] = r;
+        }
+    }
+    qsort(sorted, n, sizeof *sorted, MoreContended);
+
+    printf("\nSynchronization contention (%u of %u contended objects):\n",
+           n < top ? n : top, n);
+    printf("%-9s %-20s %5s %9s %9s %10s %8s %10s %5s %5s %6s\n",
+           "kind", "name", "objs", "ops", "blocked", "wait", "max wait",
+           "held", "queue", "donat", "convoy");
+    for (unsigned i = 0; i < n && i < top; i++) {
+        const SynchRecord *r = sorted[i];
+        printf("%-9s %-20.20s %5u %9lu %9lu %10lu %8lu %10lu %5u %5lu %6u\n",
+               KIND_NAMES[r->kind], r->name, r->instances, r->operations,
+               r->contended, r->waitTicks, r->maxWaitTicks, r->holdTicks,
+               r->maxWaiting, r->donations, r->maxConvoy);
+    }
+    for (unsigned k = 0; k < NUM_SYNCH_KINDS; k++)
+        printf("Total %s: ops %lu, blocked %lu, wait ticks %lu\n",
+               KIND_NAMES[k], ops[k], blocked[k], waited[k]);
+
+    delete [] sorted;
+}
@@ -0,0 +1,107 @@
+/// Contention profiling of synchronization objects.
+///
+/// When enabled (with `-lp`), every `Semaphore`, `Lock`, `Condition`,
+/// `RWLock` and `Barrier` gets a record where it counts how often it is
+/// used, how often a thread has to block on it, and for how long.  Records
+/// are shared by all the objects of the same kind and name, and outlive
+/// them, so that objects created and destroyed many times (the lock of
+/// every joinable thread, for instance) add up to a single line in the
+/// report printed at `Halt`.
+///
+/// All times are in simulated ticks.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_SYNCHPROFILE__HH
+#define NACHOS_THREADS_SYNCHPROFILE__HH
+
+
+enum SynchKind {
+    SEMAPHORE_KIND,
+    LOCK_KIND,
+    CONDITION_KIND,
+    RWLOCK_KIND,
+    BARRIER_KIND,
+    NUM_SYNCH_KINDS
+};
+
+/// Counters for the synchronization objects of one kind and name.
+struct SynchRecord {
+    SynchKind kind;
+    char *name;
+
+    /// Number of objects created with this kind and name.
+    unsigned instances;
+
+    /// Calls to `P`, `Acquire` or `Wait`, or acquisitions of either kind
+    /// of a readers-writer lock.
+    unsigned long operations;
+
+    /// Operations that had to block.  Every `Wait` on a condition blocks,
+    /// and every one on a barrier but the last of each round.
+    unsigned long contended;
+
+    /// Total and longest time spent blocked.
+    unsigned long waitTicks;
+    unsigned long maxWaitTicks;
+
+    /// Time the lock was held; locks only, and for readers-writer locks
+    /// only in write mode.
+    unsigned long holdTicks;
+
+    /// Threads woken up by `V`, `Signal` or `Broadcast`, by releasing a
+    /// readers-writer lock, or by completing a barrier.
+    unsigned long wakeups;
+
+    /// Threads blocked right now, and the most there ever were at once.
+    unsigned waiting;
+    unsigned maxWaiting;
+
+    /// Priority donations made to the holder of the lock; locks only.
+    unsigned long donations;
+
+    /// Convoys, that is, runs of releases that found threads waiting, and
+    /// the longest one; locks only.
+    unsigned long convoys;
+    unsigned maxConvoy;
+
+    /// Next record in the same hash bucket.
+    SynchRecord *next;
+
+    /// Note that a thread is about to block; returns the current time, to
+    /// be passed to `Woken`.
+    unsigned long Blocking();
+
+    /// Note that a thread that blocked at time `since` can go on.
+    void Woken(unsigned long since);
+};
+
+class SynchProfile {
+public:
+
+    SynchProfile();
+
+    ~SynchProfile();
+
+    /// Record for a new object of kind `kind` named `name`.
+    ///
+    /// The name is copied, so it need not outlive the object.
+    SynchRecord *Register(SynchKind kind, const char *name);
+
+    /// Print the `top` records with the most contended operations, and
+    /// totals per kind.
+    void Print(unsigned top = 15) const;
+
+private:
+
+    static const unsigned NUM_BUCKETS = 64;
+
+    SynchRecord *buckets[NUM_BUCKETS];
+
+    unsigned numRecords;
+};
+
+
+#endif
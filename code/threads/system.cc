@@ -14,6 +14,8 @@
 #include "userprog/exception.hh"
 #endif
 
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -27,12 +29,19 @@ Thread *threadToBeDestroyed;  ///< The thread that just finished.
 Scheduler *scheduler;         ///< The ready list.
 Interrupt *interrupt;         ///< Interrupt status.
 Statistics *stats;            ///< Performance metrics.
+AlarmClock *alarmClock;       ///< Threads sleeping for a while.
 Timer *timer;                 ///< The hardware timer device, for invoking
                               ///< context switches.
+StackPool *stackPool;         ///< Execution stacks for threads.
+SynchProfile *synchProfile;   ///< Synchronization contention counters;
+                              ///< null unless profiling.
+TraceLog *traceLog;           ///< Timeline of the simulation; null unless
+                              ///< tracing.
+UsageTable *usageTable;       ///< Resources used by each process.
 
 // 2007, Jose Miguel Santos Espino
 PreemptiveScheduler *preemptiveScheduler = nullptr;
-const long long DEFAULT_TIME_SLICE = 50000;
+const long long DEFAULT_TIME_SLICE = 10000;  ///< Microseconds, or ticks.
 
 #ifdef FILESYS_NEEDED
 FileSystem *fileSystem;
@@ -40,10 +49,12 @@ FileSystem *fileSystem;
 
 #ifdef FILESYS
 SynchDisk *synchDisk;
+BufferCache *bufferCache;  ///< Sectors of `synchDisk` kept in memory.
 #endif
 
 #ifdef USER_PROGRAM  // Requires either *FILESYS* or *FILESYS_STUB*.
 Machine *machine;  ///< User program memory and registers.
+Bitmap *frameMap;  ///< Physical pages in use.
 #endif
 
 #ifdef NETWORK
@@ -67,11 +78,16 @@ extern void Cleanup();
 ///
 /// * `dummy` is because every interrupt handler takes one argument, whether
 ///   it needs it or not.
+///
+/// A tickless timer is armed again only if some thread is ready; otherwise
+/// the scheduler arms it once one is.
 static void
 TimerInterruptHandler(void *dummy)
 {
-    if (interrupt->GetStatus() != IDLE_MODE)
+    if (interrupt->GetStatus() != IDLE_MODE && scheduler->ShouldPreempt())
         interrupt->YieldOnReturn();
+    if (timer->IsTickless() && scheduler->HasReady())
+        timer->Arm();
 }
 
 /// Initialize Nachos global data structures.
@@ -94,6 +110,11 @@ Initialize(int argc, char **argv)
     int argCount;
     const char *debugArgs = "";
     bool randomYield = false;
+    bool ticklessTimer = false;
+    bool profileSynch = false;
+    const char *histogramName = nullptr;  // Scheduling histograms.
+    const char *traceName = nullptr;      // Timeline.
+    SchedulingPolicy policy = PRIORITY_POLICY;
 
     // 2007, Jose Miguel Santos Espino
     bool preemptiveScheduling = false;
@@ -101,10 +122,17 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
+    const char *referenceLogName = nullptr;  // Record page references.
 #endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // Format disk.
 #endif
+#ifdef FILESYS
+    unsigned cacheSectors = DEFAULT_CACHE_SECTORS;
+    CachePolicy cachePolicy = CACHE_LRU;
+    unsigned readAhead = DEFAULT_READ_AHEAD;
+    unsigned long writeBehind = DEFAULT_WRITE_BEHIND;
+#endif
 #ifdef NETWORK
     double rely = 1;  // Network reliability.
     int netname = 0;  // UNIX socket name.
@@ -126,10 +154,33 @@ Initialize(int argc, char **argv)
             randomYield = true;
             argCount = 2;
         }
+        else if (!strcmp(*argv, "-lp"))
+            profileSynch = true;
+        else if (!strcmp(*argv, "-tl"))
+            ticklessTimer = true;
+        else if (!strcmp(*argv, "-tr")) {
+            ASSERT(argc > 1);
+            traceName = *(argv + 1);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-sh")) {
+            ASSERT(argc > 1);
+            histogramName = *(argv + 1);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-sp")) {
+            ASSERT(argc > 1);
+            if (!ParseSchedulingPolicy(*(argv + 1), &policy)) {
+                fprintf(stderr, "Unknown scheduling policy `%s`.\n",
+                        *(argv + 1));
+                exit(1);
+            }
+            argCount = 2;
+        }
         // 2007, Jose Miguel Santos Espino
         else if (!strcmp(*argv, "-p")) {
             preemptiveScheduling = true;
-            if (argc == 1) {
+            if (argc == 1 || !isdigit(**(argv + 1))) {
                 timeSlice = DEFAULT_TIME_SLICE;
             } else {
                 timeSlice = atoi(*(argv+1));
@@ -139,11 +190,39 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = true;
+        else if (!strcmp(*argv, "-rl")) {
+            ASSERT(argc > 1);
+            referenceLogName = *(argv + 1);
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = true;
 #endif
+#ifdef FILESYS
+        if (!strcmp(*argv, "-bc")) {
+            ASSERT(argc > 1);
+            cacheSectors = atoi(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-bp")) {
+            ASSERT(argc > 1);
+            if (!ParseCachePolicy(*(argv + 1), &cachePolicy)) {
+                fprintf(stderr, "Unknown cache policy `%s`.\n",
+                        *(argv + 1));
+                exit(1);
+            }
+            argCount = 2;
+        } else if (!strcmp(*argv, "-ra")) {
+            ASSERT(argc > 1);
+            readAhead = atoi(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-wb")) {
+            ASSERT(argc > 1);
+            writeBehind = atol(*(argv + 1));
+            argCount = 2;
+        }
+#endif
 #ifdef NETWORK
         if (!strcmp(*argv, "-n")) {
             ASSERT(argc > 1);
@@ -159,10 +238,27 @@ Initialize(int argc, char **argv)
 
     debug.SetFlags(debugArgs);  // Initialize `DEBUG` messages.
     stats = new Statistics;     // Collect statistics.
+    if (histogramName != nullptr) {
+        stats->histogramFile = fopen(histogramName, "w");
+        if (stats->histogramFile == nullptr) {
+            fprintf(stderr, "Cannot create histogram file `%s`.\n",
+                    histogramName);
+            exit(1);
+        }
+    }
     interrupt = new Interrupt;  // Start up interrupt handling.
-    scheduler = new Scheduler;  // Initialize the ready queue.
-    if (randomYield)            // Start the timer (if needed).
-        timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    if (profileSynch)           // Before any synchronization object.
+        synchProfile = new SynchProfile;
+    if (traceName != nullptr)   // Before any thread.
+        traceLog = new TraceLog(traceName);
+    scheduler = new Scheduler(policy);  // Initialize the ready queue.
+    usageTable = new UsageTable;        // Before any thread.
+    stackPool = new StackPool;          // Thread stacks.
+    alarmClock = new AlarmClock;        // Sleeping threads.
+    if (randomYield || scheduler->NeedsTimer())  // Start the timer (if
+                                                 // needed).
+        timer = new Timer(TimerInterruptHandler, 0, randomYield,
+                          ticklessTimer);
 
     threadToBeDestroyed = nullptr;
 
@@ -178,17 +274,22 @@ Initialize(int argc, char **argv)
     // Jose Miguel Santos Espino, 2007
     if (preemptiveScheduling) {
         preemptiveScheduler = new PreemptiveScheduler();
-        preemptiveScheduler->SetUp(timeSlice);
+        preemptiveScheduler->SetUp(timeSlice, randomYield);
     }
 
 #ifdef USER_PROGRAM
     Debugger *d = debugUserProg ? new Debugger : nullptr;
     machine = new Machine(d);  // This must come first.
+    frameMap = new Bitmap(NUM_PHYS_PAGES);
+    if (referenceLogName != nullptr)
+        machine->GetMMU()->referenceLog = new ReferenceLog(referenceLogName);
     SetExceptionHandlers();
 #endif
 
 #ifdef FILESYS
     synchDisk = new SynchDisk("DISK");
+    bufferCache = new BufferCache(synchDisk, cacheSectors, cachePolicy,
+                                  readAhead, writeBehind);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -214,6 +315,7 @@ Cleanup()
 #endif
 
 #ifdef USER_PROGRAM
+    delete frameMap;
     delete machine;
 #endif
 
@@ -222,12 +324,20 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete bufferCache;
     delete synchDisk;
 #endif
 
+    delete traceLog;  // Writes out the pending events.
     delete timer;
+    delete alarmClock;
+    delete stackPool;
     delete scheduler;
+    delete usageTable;
     delete interrupt;
+    delete synchProfile;
+    if (stats->histogramFile != nullptr)
+        fclose(stats->histogramFile);
 
     exit(0);
 }
@@ -9,12 +9,17 @@
 #define NACHOS_THREADS_SYSTEM__HH
 
 
+#include "alarm_clock.hh"
 #include "thread.hh"
 #include "scheduler.hh"
+#include "stack_pool.hh"
+#include "synch_profile.hh"
+#include "usage_table.hh"
 #include "lib/utility.hh"
 #include "machine/interrupt.hh"
 #include "machine/statistics.hh"
 #include "machine/timer.hh"
+#include "machine/trace_log.hh"
 
 
 /// Initialization and cleanup routines.
@@ -32,10 +37,17 @@ extern Scheduler *scheduler;         ///< The ready list.
 extern Interrupt *interrupt;         ///< Interrupt status.
 extern Statistics *stats;            ///< Performance metrics.
 extern Timer *timer;                 ///< The hardware alarm clock.
+extern AlarmClock *alarmClock;       ///< Threads sleeping for a while.
+extern StackPool *stackPool;         ///< Execution stacks for threads.
+extern SynchProfile *synchProfile;   ///< Contention counters, if enabled.
+extern TraceLog *traceLog;           ///< Timeline, if enabled.
+extern UsageTable *usageTable;       ///< Resources used by each process.
 
 #ifdef USER_PROGRAM
 #include "machine/machine.hh"
+#include "lib/bitmap.hh"
 extern Machine *machine;  // User program memory and registers.
+extern Bitmap *frameMap;  // Physical pages in use.
 #endif
 
 #ifdef FILESYS_NEEDED  // *FILESYS* or *FILESYS_STUB*.
@@ -45,7 +57,9 @@ extern FileSystem *fileSystem;
 
 #ifdef FILESYS
 #include "filesys/synch_disk.hh"
+#include "filesys/buffer_cache.hh"
 extern SynchDisk *synchDisk;
+extern BufferCache *bufferCache;
 #endif
 
 #ifdef NETWORK
@@ -23,12 +23,15 @@
 #include "system.hh"
 
 #include <stdio.h>
+#include <string.h>
 
 
 /// This is put at the top of the execution stack, for detecting stack
 /// overflows.
 const unsigned STACK_FENCEPOST = 0xDEADBEEF;
 
+unsigned Thread::nextId = 0;
+
 
 static inline bool
 IsThreadStatus(ThreadStatus s)
@@ -40,21 +43,43 @@ IsThreadStatus(ThreadStatus s)
 /// `Thread::Fork`.
 ///
 /// * `threadName` is an arbitrary string, useful for debugging.
-Thread::Thread(const char *threadName, bool join, unsigned firstPriority)
+Thread::Thread(const char *threadName, bool join, unsigned firstPriority,
+               unsigned stackWords)
 {
-    name     = threadName;
-    stackTop = nullptr;
-    stack    = nullptr;
+    ASSERT(stackWords > 0);
+
+    name      = threadName;
+    stackTop  = nullptr;
+    stack     = nullptr;
+    stackSize = stackWords;
     status   = JUST_CREATED;
     joinable = join;
     // Cota de prioridades.
     priority = firstPriority > MAX_PRIORITY ? MAX_PRIORITY : firstPriority;
     oldPriority = priority;
+    id          = nextId++;
+    readyLevel  = 0;
+    mlfqLevel   = MAX_PRIORITY;
+    levelTicks  = 0;
+    pass        = 0;
+    shareSlot   = 0;
+    memset(&usage, 0, sizeof usage);
+    readySince  = 0;
+    runSince    = 0;
+    wakeAt      = 0;
+    heldLocks   = nullptr;
+    waitingOn   = nullptr;
+    heldRWLocks = nullptr;
 
     if(joinable) {
       channel = new Channel(name);
     }
 
+    if (traceLog != nullptr)
+        traceLog->NameTrack(FIRST_THREAD_TRACK + id, name);
+    if (usageTable != nullptr)
+        usageTable->Add(this);
+
 #ifdef USER_PROGRAM
     space    = nullptr;
 #endif
@@ -73,9 +98,17 @@ Thread::~Thread()
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
     ASSERT(this != currentThread);
-    if (stack != nullptr)
-        SystemDep::DeallocBoundedArray((char *) stack,
-                                       STACK_SIZE * sizeof *stack);
+#ifdef USER_PROGRAM
+    scheduler->ForgetUserState(this);
+#endif
+    if (usageTable != nullptr)
+        usageTable->Remove(this);
+    if (stats->histogramFile != nullptr)
+        WriteHistograms(stats->histogramFile);
+    if (stack != nullptr) {
+        CheckOverflow();
+        stackPool->Free((char *) stack, stackSize * sizeof *stack);
+    }
 }
 
 /// Invoke `(*func)(arg)`, allowing caller and callee to execute
@@ -116,8 +149,11 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
 }
 
 /// Check a thread's stack to see if it has overrun the space that has been
-/// allocated for it.  If we had a smarter compiler, we would not need to
-/// worry about this, but we do not.
+/// allocated for it.
+///
+/// Overflows normally hit the guard page below the stack and crash at once;
+/// this check, done when the thread is destroyed, catches the ones that
+/// jumped over the guard page and landed on the fencepost.
 ///
 /// NOTE: Nachos will not catch all stack overflow conditions.  In other
 /// words, your program may still crash because of an overflow.
@@ -141,6 +177,12 @@ Thread::SetStatus(ThreadStatus st)
     status = st;
 }
 
+ThreadStatus
+Thread::GetStatus() const
+{
+    return status;
+}
+
 const char *
 Thread::GetName() const
 {
@@ -153,6 +195,17 @@ Thread::Print() const
     printf("%s, ", name);
 }
 
+void
+Thread::WriteHistograms(FILE *file) const
+{
+    ASSERT(file != nullptr);
+
+    fprintf(file, "ready\tthread\t%s\t", name);
+    readyLatency.Write(file);
+    fprintf(file, "run\tthread\t%s\t", name);
+    runLength.Write(file);
+}
+
 /// Called by `ThreadRoot` when a thread is done executing the forked
 /// procedure.
 ///
@@ -170,7 +223,9 @@ Thread::Finish()
     interrupt->SetLevel(INT_OFF);
     ASSERT(this == currentThread);
 
-    DEBUG('t', "Finishing thread \"%s\"\n", GetName());
+    scheduler->ChargeCurrent();
+    DEBUG('t', "Finishing thread \"%s\" (%lu user, %lu system ticks)\n",
+          GetName(), usage.userTicks, usage.systemTicks);
 
     if(joinable) {
       channel->Send(0);
@@ -207,6 +262,7 @@ Thread::Yield()
 
     Thread *nextThread = scheduler->FindNextToRun();
     if (nextThread != nullptr) {
+        usage.involuntarySwitches++;
         scheduler->ReadyToRun(this);
         scheduler->Run(nextThread);
     }
@@ -238,6 +294,7 @@ Thread::Sleep()
 
     Thread *nextThread;
     status = BLOCKED;
+    usage.voluntarySwitches++;
     while ((nextThread = scheduler->FindNextToRun()) == nullptr) {
         interrupt->Idle();  // No one to run, wait for an interrupt.
     }
@@ -245,6 +302,16 @@ Thread::Sleep()
     scheduler->Run(nextThread);  // Returns when we have been signalled.
 }
 
+/// Unlike looping on `Yield`, the thread is not ready while it waits, so
+/// it takes no CPU time and the machine can idle until it is due.
+void
+Thread::SleepFor(unsigned long ticks)
+{
+    ASSERT(this == currentThread);
+
+    alarmClock->Sleep(ticks);
+}
+
 void
 Thread::Join() {
   int message;
@@ -255,12 +322,12 @@ Thread::Join() {
 }
 
 unsigned
-Thread::GetPriority() {
+Thread::GetPriority() const {
   return priority;
 }
 
 unsigned
-Thread::GetOldPriority() {
+Thread::GetOldPriority() const {
   return oldPriority;
 }
 
@@ -302,10 +369,10 @@ Thread::StackAllocate(VoidFunctionPtr func, void *arg)
     ASSERT(func != nullptr);
 
     stack = (HostMemoryAddress *)
-              SystemDep::AllocBoundedArray(STACK_SIZE * sizeof *stack);
+              stackPool->Allocate(stackSize * sizeof *stack);
 
     // Stacks in x86 work from high addresses to low addresses.
-    stackTop = stack + STACK_SIZE - 4;  // -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;  // -4 to be on the safe side!
 
     // x86 passes the return address on the stack.  In order for `SWITCH` to
     // go to `ThreadRoot` when we switch to this thread, the return address
@@ -21,8 +21,10 @@
 /// faults, so that is not a sure sign that your thread stacks are too
 /// small.)
 ///
-/// One thing to try if you find yourself with segmentation faults is to
-/// increase the size of thread stack -- `STACK_SIZE`.
+/// Stacks are mapped with a guard page below them, so that overflowing one
+/// makes Nachos crash with a segmentation fault right at the offending
+/// access.  If that happens, increase the size of the thread stack -- either
+/// `STACK_SIZE` or the size passed to the `Thread` constructor.
 ///
 /// In this interface, forking a thread takes two steps.  We must first
 /// allocate a data structure for it:
@@ -40,6 +42,8 @@
 
 
 #include "lib/utility.hh"
+#include "lib/histogram.hh"
+#include "lib/intrusive_list.hh"
 
 #ifdef USER_PROGRAM
 #include "machine/machine.hh"
@@ -53,7 +57,7 @@
 /// registers.  We allocate room for the maximum of these two architectures.
 const unsigned MACHINE_STATE_SIZE = 17;
 
-/// Size of the thread's private execution stack.
+/// Default size of the thread's private execution stack.
 ///
 /// In words.
 ///
@@ -71,6 +75,27 @@ enum ThreadStatus {
 };
 
 class Channel;
+class Lock;
+class RWLock;
+
+/// Resources used by a thread, kept up to date as it runs.  Times are in
+/// ticks.
+struct ThreadUsage {
+    unsigned long userTicks;    ///< Running user code.
+    unsigned long systemTicks;  ///< Running in the kernel.
+    unsigned long readyTicks;   ///< Ready, waiting for the CPU.
+    unsigned long pageFaults;
+    unsigned long diskReads;
+    unsigned long diskWrites;
+
+    /// Times it gave up the CPU by blocking or finishing, and by yielding
+    /// or being preempted.
+    unsigned long voluntarySwitches;
+    unsigned long involuntarySwitches;
+
+    /// Add the usage of `other` to this one.
+    void Add(const ThreadUsage &other);
+};
 
 /// The following class defines a “thread control block” -- which represents
 /// a single thread of execution.
@@ -101,7 +126,10 @@ private:
 public:
 
     /// Initialize a `Thread`.
-    Thread(const char *debugName, bool join = false, unsigned firstPriority = 0);
+    ///
+    /// * `stackWords` is the size of its execution stack, in words.
+    Thread(const char *debugName, bool join = false,
+           unsigned firstPriority = 0, unsigned stackWords = STACK_SIZE);
 
     /// Deallocate a Thread.
     ///
@@ -116,8 +144,8 @@ public:
 
     void Join();
 
-    unsigned GetPriority();
-    unsigned GetOldPriority();
+    unsigned GetPriority() const;
+    unsigned GetOldPriority() const;
 
     void SetPriority(unsigned newPriority);
 
@@ -127,6 +155,10 @@ public:
     /// Put the thread to sleep and relinquish the processor.
     void Sleep();
 
+    /// Block the thread for `ticks` ticks of simulated time, without using
+    /// the CPU in the meantime.
+    void SleepFor(unsigned long ticks);
+
     /// The thread is done executing.
     void Finish();
 
@@ -135,10 +167,71 @@ public:
 
     void SetStatus(ThreadStatus st);
 
+    ThreadStatus GetStatus() const;
+
     const char *GetName() const;
 
     void Print() const;
 
+    /// Link for the queue the thread is waiting on: the ready list while
+    /// it is ready to run, or a synchronization queue or the sleepers of
+    /// the alarm clock while it is blocked.
+    ListLink<Thread> queueLink;
+
+    /// Unique among the threads created so far; names the track of the
+    /// thread in the trace.
+    unsigned id;
+
+    /// Ready list level the thread was queued on.  Only meaningful while
+    /// the thread is ready.
+    unsigned readyLevel;
+
+    /// Current level under the MLFQ policy.
+    unsigned mlfqLevel;
+
+    /// CPU ticks used at `mlfqLevel`.
+    unsigned long levelTicks;
+
+    /// Virtual time under the stride policy: grows with the CPU time used,
+    /// more slowly the more tickets the thread has.
+    unsigned long long pass;
+
+    /// Slot in the proportional-share ready structure, while ready.
+    unsigned shareSlot;
+
+    /// Resources used so far.  CPU ticks are charged by the scheduler.
+    ThreadUsage usage;
+
+    /// Link for the live threads of the `UsageTable`.
+    ListLink<Thread> usageLink;
+
+    /// Time this thread spent ready before each of its runs, and the
+    /// length of each run.  Recorded by the scheduler, like the
+    /// per-priority ones in `Statistics`.
+    Histogram readyLatency;
+    Histogram runLength;
+
+    /// Time it was last put on the ready list, and busy time at which it
+    /// was last dispatched.
+    unsigned long readySince;
+    unsigned long runSince;
+
+    /// Time it is due to wake up, while sleeping in the alarm clock.
+    unsigned long wakeAt;
+
+    /// Locks held by the thread, chained through `Lock::nextHeld`, and the
+    /// lock it is blocked on, if any; for priority donation.
+    Lock *heldLocks;
+    Lock *waitingOn;
+
+    /// Readers-writer locks held by the thread for writing, chained
+    /// through `RWLock::nextHeld`; their waiters donate too.
+    RWLock *heldRWLocks;
+
+    /// Write the histograms of the thread to `file`, in the format of
+    /// `Statistics::histogramFile`.
+    void WriteHistograms(FILE *file) const;
+
 private:
     // Some of the private data for this class is listed above.
 
@@ -147,6 +240,9 @@ private:
     /// Null if this is the main thread.  (If null, do not deallocate stack.)
     HostMemoryAddress *stack;
 
+    /// Size of the stack, in words.
+    unsigned stackSize;
+
     /// Ready, running or blocked.
     ThreadStatus status;
 
@@ -155,6 +251,9 @@ private:
     unsigned priority;
     unsigned oldPriority;
 
+    /// Identifier for the next thread to be created.
+    static unsigned nextId;
+
     /// Allocate a stack for thread.  Used internally by `Fork`.
     void StackAllocate(VoidFunctionPtr func, void *arg);
 
@@ -191,6 +290,11 @@ extern "C" {
 
     // Stop running `oldThread` and start running `newThread`.
     void SWITCH(Thread *oldThread, Thread *newThread);
+
+    // Like `SWITCH`, but only save the registers that a function call
+    // preserves; the others are dead, since `SWITCH_LIGHT` is called like
+    // any other function.
+    void SWITCH_LIGHT(Thread *oldThread, Thread *newThread);
 }
 
 
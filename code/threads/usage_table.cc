@@ -0,0 +1,124 @@
+/// Routines to account for the resources used by each process.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "usage_table.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/// Process of `thread`, as a row identifier.
+static int
+SpaceOf(const Thread *thread)
+{
+#ifdef USER_PROGRAM
+    if (thread->space != nullptr)
+        return thread->space->GetId();
+#endif
+    return -1;
+}
+
+void
+ThreadUsage::Add(const ThreadUsage &other)
+{
+    userTicks           += other.userTicks;
+    systemTicks         += other.systemTicks;
+    readyTicks          += other.readyTicks;
+    pageFaults          += other.pageFaults;
+    diskReads           += other.diskReads;
+    diskWrites          += other.diskWrites;
+    voluntarySwitches   += other.voluntarySwitches;
+    involuntarySwitches += other.involuntarySwitches;
+}
+
+UsageTable::UsageTable()
+{
+    capacity = 4;
+    numRows  = 0;
+    rows     = new Row [capacity];
+}
+
+UsageTable::~UsageTable()
+{
+    delete [] rows;
+}
+
+void
+UsageTable::Add(Thread *thread)
+{
+    ASSERT(thread != nullptr);
+    live.Append(thread);
+}
+
+void
+UsageTable::Remove(Thread *thread)
+{
+    ASSERT(thread != nullptr);
+
+    live.Remove(thread);
+    Row *row = RowOf(SpaceOf(thread));
+    row->threads++;
+    row->usage.Add(thread->usage);
+}
+
+UsageTable::Row *
+UsageTable::RowOf(int space)
+{
+    for (unsigned i = 0; i < numRows; i++)
+        if (rows[i].space == space)
+            return &rows[i];
+
+    if (numRows == capacity) {
+        Row *larger = new Row [2 * capacity];
+        memcpy(larger, rows, numRows * sizeof *rows);
+        delete [] rows;
+        rows = larger;
+        capacity *= 2;
+    }
+    Row *row = &rows[numRows++];
+    memset(row, 0, sizeof *row);
+    row->space = space;
+    return row;
+}
+
+/// The live threads are folded into the rows for printing, and taken out
+/// again, so that the table can be printed more than once.
+void
+UsageTable::Print()
+{
+    unsigned retiredRows = numRows;
+    Row *retired = new Row [retiredRows > 0 ? retiredRows : 1];
+    memcpy(retired, rows, retiredRows * sizeof *rows);
+
+    for (Thread *t = live.Head(); t != nullptr; t = live.Next(t)) {
+        Row *row = RowOf(SpaceOf(t));
+        row->threads++;
+        row->usage.Add(t->usage);
+    }
+
+    printf("Usage by process (ticks):\n");
+    printf("%-10s %7s %10s %10s %10s %7s %7s %7s %8s %8s\n", "process",
+           "threads", "user", "system", "ready", "faults", "reads",
+           "writes", "blocked", "yielded");
+    for (unsigned i = 0; i < numRows; i++) {
+        const Row &r = rows[i];
+        char name[16];
+        if (r.space < 0)
+            snprintf(name, sizeof name, "kernel");
+        else
+            snprintf(name, sizeof name, "space %d", r.space);
+        printf("%-10s %7u %10lu %10lu %10lu %7lu %7lu %7lu %8lu %8lu\n",
+               name, r.threads, r.usage.userTicks, r.usage.systemTicks,
+               r.usage.readyTicks, r.usage.pageFaults, r.usage.diskReads,
+               r.usage.diskWrites, r.usage.voluntarySwitches,
+               r.usage.involuntarySwitches);
+    }
+
+    memcpy(rows, retired, retiredRows * sizeof *rows);
+    numRows = retiredRows;
+    delete [] retired;
+}
@@ -0,0 +1,62 @@
+/// Data structures to account for the resources used by each process.
+///
+/// Every thread keeps its own `ThreadUsage` up to date as it runs.  The
+/// table follows the threads that are alive, and keeps the usage of the
+/// ones already destroyed, so that the use of every process, from start to
+/// end, can be printed when halting.
+///
+/// A process is an address space.  Threads that only run in the kernel are
+/// counted together, as one more process.
+///
+/// Copyright (c) 2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_USAGETABLE__HH
+#define NACHOS_THREADS_USAGETABLE__HH
+
+
+#include "thread.hh"
+#include "lib/intrusive_list.hh"
+
+
+class UsageTable {
+public:
+
+    /// Initialize an empty table.
+    UsageTable();
+
+    ~UsageTable();
+
+    /// Start following `thread`, just created.
+    void Add(Thread *thread);
+
+    /// `thread` is being destroyed: keep its usage in the row of its
+    /// process.
+    void Remove(Thread *thread);
+
+    /// Print a line per process, including the threads still alive.
+    void Print();
+
+private:
+
+    /// Accumulated usage of a process.
+    struct Row {
+        int space;  ///< Address space identifier, or -1 for the kernel.
+        unsigned threads;
+        ThreadUsage usage;
+    };
+
+    /// Row of the process identified by `space`, created if needed.
+    Row *RowOf(int space);
+
+    Row *rows;
+    unsigned numRows;
+    unsigned capacity;
+
+    /// Threads alive, linked through `Thread::usageLink`.
+    IntrusiveList<Thread, &Thread::usageLink> live;
+};
+
+
+#endif
@@ -0,0 +1,67 @@
+/// Test program for memory-mapped files.
+///
+/// Write a file, map it, check and change its contents through memory,
+/// unmap it, and read it back with `Read` to see that the change reached
+/// the file.  Map it again, to see that the virtual pages of the removed
+/// mapping are reused.
+
+
+#include "syscall.h"
+
+
+#define FILE_NAME  "mmap.txt"
+#define CONTENTS   "hello, mapped world\n"
+#define CHANGED    "HELLO, mapped world\n"
+#define SIZE       (sizeof CONTENTS - 1)
+
+/// Print `message` and stop the machine.
+static void
+Stop(const char *message, int length)
+{
+    Write(message, length, CONSOLE_OUTPUT);
+    Halt();
+}
+
+#define STOP(message)  Stop(message, sizeof message - 1)
+
+int
+main(void)
+{
+    Create(FILE_NAME);
+    OpenFileId o = Open(FILE_NAME);
+    if (o < 0)
+        STOP("mmap: cannot create " FILE_NAME "\n");
+    Write(CONTENTS, SIZE, o);
+    Close(o);
+
+    int addr = Mmap(FILE_NAME);
+    if (addr == -1)
+        STOP("mmap: Mmap failed\n");
+    char *p = (char *) addr;
+    for (unsigned i = 0; i < SIZE; i++)
+        if (p[i] != CONTENTS[i])
+            STOP("mmap: mapped contents differ from the file\n");
+    for (unsigned i = 0; i < 5; i++)
+        p[i] -= 'a' - 'A';
+    if (Munmap(addr) == -1)
+        STOP("mmap: Munmap failed\n");
+    if (Munmap(addr) != -1)
+        STOP("mmap: second Munmap succeeded\n");
+
+    char buffer[SIZE];
+    o = Open(FILE_NAME);
+    if (o < 0 || Read(buffer, SIZE, o) != SIZE)
+        STOP("mmap: cannot read " FILE_NAME " back\n");
+    Close(o);
+    for (unsigned i = 0; i < SIZE; i++)
+        if (buffer[i] != CHANGED[i])
+            STOP("mmap: change did not reach the file\n");
+
+    int again = Mmap(FILE_NAME);
+    if (again != addr)
+        STOP("mmap: unmapped range was not reused\n");
+    Munmap(again);
+
+    STOP("mmap: ok\n");
+    return 0;
+}
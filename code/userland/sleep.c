@@ -0,0 +1,26 @@
+/// Test program for the `Sleep` system call.
+///
+/// Sleep for a while, then try the calls that must return at once (no
+/// ticks, or a negative number of them), and halt.  Run it with `-d e` to
+/// see the calls; the total ticks reported when halting include the time
+/// slept, with the machine idle meanwhile.
+///
+/// It uses no other system call than `Halt`, so it can run before files and
+/// the console are available to user programs.
+
+
+#include "syscall.h"
+
+
+#define TICKS  1000
+
+int
+main(void)
+{
+    Sleep(TICKS);
+    Sleep(0);
+    Sleep(-TICKS);
+    Halt();
+    // Not reached.
+    return -1;
+}
@@ -85,6 +85,22 @@ Yield:
         j       $31
         .end    Yield
 
+        .globl  Sleep
+        .ent    Sleep
+Sleep:
+        addiu   $2, $0, SC_SLEEP
+        syscall
+        j       $31
+        .end    Sleep
+
+        .globl  GetUsage
+        .ent    GetUsage
+GetUsage:
+        addiu   $2, $0, SC_GETUSAGE
+        syscall
+        j       $31
+        .end    GetUsage
+
         .globl  Create
         .ent    Create
 Create:
@@ -133,6 +149,30 @@ Close:
         j       $31
         .end    Close
 
+        .globl  Sync
+        .ent    Sync
+Sync:
+        addiu   $2, $0, SC_SYNC
+        syscall
+        j       $31
+        .end    Sync
+
+        .globl  Mmap
+        .ent    Mmap
+Mmap:
+        addiu   $2, $0, SC_MMAP
+        syscall
+        j       $31
+        .end    Mmap
+
+        .globl  Munmap
+        .ent    Munmap
+Munmap:
+        addiu   $2, $0, SC_MUNMAP
+        syscall
+        j       $31
+        .end    Munmap
+
 /// Dummy function to keep gcc happy.
         .globl  __main
         .ent    __main
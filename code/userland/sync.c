@@ -0,0 +1,36 @@
+/// Test program for the `Sync` system call.
+///
+/// Write a file, force it to the disk with `Sync`, and halt.  With write
+/// behind enabled (`-wb`), the data would otherwise still be in the buffer
+/// cache.  Run it with `-d e` to see the calls, and check the file
+/// afterwards with `-pr sync.txt`.
+
+
+#include "syscall.h"
+
+
+#define FILE_NAME  "sync.txt"
+#define CONTENTS   "written before Sync\n"
+#define SIZE       (sizeof CONTENTS - 1)
+
+#define MESSAGE(s)  Write(s, sizeof s - 1, CONSOLE_OUTPUT)
+
+int
+main(void)
+{
+    Create(FILE_NAME);
+    OpenFileId o = Open(FILE_NAME);
+    if (o < 0) {
+        MESSAGE("sync: cannot create " FILE_NAME "\n");
+        Halt();
+    }
+    if (Write(CONTENTS, SIZE, o) != SIZE)
+        MESSAGE("sync: short write\n");
+    Close(o);
+
+    if (Sync() != 0)
+        MESSAGE("sync: Sync failed\n");
+    Halt();
+    // Not reached.
+    return -1;
+}
@@ -0,0 +1,84 @@
+/// Test program for the `GetUsage` system call.
+///
+/// Burn some CPU, sleep, and print the resources used, one field per line.
+/// Then check that bad pointers are refused: a null one, and one past the
+/// end of the address space.
+
+
+#include "syscall.h"
+
+
+/// An address that no program can map: the top of the MIPS address space.
+#define BAD_ADDRESS  ((Usage *) 0x7FFFFFF0)
+
+static unsigned
+StringLength(const char *s)
+{
+    unsigned i;
+    for (i = 0; s[i] != '\0'; i++);
+    return i;
+}
+
+static void
+PrintString(const char *s)
+{
+    Write(s, StringLength(s), CONSOLE_OUTPUT);
+}
+
+static void
+PrintInt(int n)
+{
+    char buffer[12];
+    unsigned i = sizeof buffer;
+    unsigned u = n < 0 ? -n : n;
+
+    buffer[--i] = '\0';
+    do {
+        buffer[--i] = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (n < 0)
+        buffer[--i] = '-';
+    PrintString(&buffer[i]);
+}
+
+static void
+PrintField(const char *name, int value)
+{
+    PrintString(name);
+    PrintString(": ");
+    PrintInt(value);
+    PrintString("\n");
+}
+
+int
+main(void)
+{
+    volatile int sum = 0;
+    for (int i = 0; i < 10000; i++)
+        sum += i;
+    Sleep(100);
+
+    Usage u;
+    if (GetUsage(&u) != 0) {
+        PrintString("usage: GetUsage failed\n");
+        Halt();
+    }
+    PrintField("user ticks", u.userTicks);
+    PrintField("system ticks", u.systemTicks);
+    PrintField("ready ticks", u.readyTicks);
+    PrintField("page faults", u.pageFaults);
+    PrintField("disk reads", u.diskReads);
+    PrintField("disk writes", u.diskWrites);
+    PrintField("voluntary switches", u.voluntarySwitches);
+    PrintField("involuntary switches", u.involuntarySwitches);
+
+    if (GetUsage(0) != -1)
+        PrintString("usage: null pointer accepted\n");
+    if (GetUsage(BAD_ADDRESS) != -1)
+        PrintString("usage: bad pointer accepted\n");
+
+    Halt();
+    // Not reached.
+    return -1;
+}
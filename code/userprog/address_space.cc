@@ -13,9 +13,37 @@
 #include <string.h>
 
 
+unsigned AddressSpace::nextId = 0;
+
+/// Copy `size` bytes of a segment of `exe`, starting at `offset` within
+/// it, to `virtualAddr` in the address space of `pageTable`.  Consecutive
+/// virtual pages need not be in consecutive frames, so the copy is done a
+/// page at a time.
+static void
+LoadSegment(Executable *exe, bool code, uint32_t virtualAddr,
+            uint32_t size, const TranslationEntry *pageTable)
+{
+    char *mainMemory = machine->GetMMU()->mainMemory;
+
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t addr   = virtualAddr + done;
+        uint32_t offset = addr % PAGE_SIZE;
+        uint32_t chunk  = PAGE_SIZE - offset;
+        if (chunk > size - done)
+            chunk = size - done;
+        char *dest = &mainMemory[pageTable[addr / PAGE_SIZE].physicalPage
+                                 * PAGE_SIZE + offset];
+        if (code)
+            exe->ReadCodeBlock(dest, chunk, done);
+        else
+            exe->ReadDataBlock(dest, chunk, done);
+        done += chunk;
+    }
+}
+
 /// First, set up the translation from program memory to physical memory.
-/// For now, this is really simple (1:1), since we are only uniprogramming,
-/// and we have a single unsegmented page table.
+/// Frames are taken from `frameMap`, since other address spaces may hold
+/// some (including any frame of their mapped files).
 AddressSpace::AddressSpace(OpenFile *executable_file)
 {
     ASSERT(executable_file != nullptr);
@@ -39,11 +67,23 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
 
     // First, set up the translation.
 
+    imagePages = numPages;
+    nextVictim = 0;
+    id = nextId++;
+
+    char *mainMemory = machine->GetMMU()->mainMemory;
+
     pageTable = new TranslationEntry[numPages];
     for (unsigned i = 0; i < numPages; i++) {
+        int frame = frameMap->Find();
+        ASSERT(frame != -1);  // No virtual memory for program pages yet.
+
+        // Zero out the frame, for the unitialized data segment and the
+        // stack segment.
+        memset(&mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+
         pageTable[i].virtualPage  = i;
-          // For now, virtual page number = physical page number.
-        pageTable[i].physicalPage = i;
+        pageTable[i].physicalPage = frame;
         pageTable[i].valid        = true;
         pageTable[i].use          = false;
         pageTable[i].dirty        = false;
@@ -52,12 +92,6 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
           // set its pages to be read-only.
     }
 
-    char *mainMemory = machine->GetMMU()->mainMemory;
-
-    // Zero out the entire address space, to zero the unitialized data
-    // segment and the stack segment.
-    memset(mainMemory, 0, size);
-
     // Then, copy in the code and data segments into memory.
     uint32_t codeSize = exe.GetCodeSize();
     uint32_t initDataSize = exe.GetInitDataSize();
@@ -65,22 +99,30 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
         uint32_t virtualAddr = exe.GetCodeAddr();
         DEBUG('a', "Initializing code segment, at 0x%X, size %u\n",
               virtualAddr, codeSize);
-        exe.ReadCodeBlock(&mainMemory[virtualAddr], codeSize, 0);
+        LoadSegment(&exe, true, virtualAddr, codeSize, pageTable);
     }
     if (initDataSize > 0) {
         uint32_t virtualAddr = exe.GetInitDataAddr();
         DEBUG('a', "Initializing data segment, at 0x%X, size %u\n",
               virtualAddr, initDataSize);
-        exe.ReadDataBlock(&mainMemory[virtualAddr], initDataSize, 0);
+        LoadSegment(&exe, false, virtualAddr, initDataSize, pageTable);
     }
 
 }
 
 /// Deallocate an address space.
 ///
-/// Nothing for now!
+/// Mapped files are unmapped first, so that their contents reach the disk.
 AddressSpace::~AddressSpace()
 {
+    for (unsigned i = 0; i < mappings.SIZE; i++)
+        if (mappings.HasKey(i))
+            Unmap(mappings.Get(i)->firstPage * PAGE_SIZE);
+
+    for (unsigned i = 0; i < numPages; i++)
+        if (pageTable[i].valid)
+            frameMap->Clear(pageTable[i].physicalPage);
+
     delete [] pageTable;
 }
 
@@ -106,9 +148,9 @@ AddressSpace::InitRegisters()
     // Set the stack register to the end of the address space, where we
     // allocated the stack; but subtract off a bit, to make sure we do not
     // accidentally reference off the end!
-    machine->WriteRegister(STACK_REG, numPages * PAGE_SIZE - 16);
+    machine->WriteRegister(STACK_REG, imagePages * PAGE_SIZE - 16);
     DEBUG('a', "Initializing stack register to %u\n",
-          numPages * PAGE_SIZE - 16);
+          imagePages * PAGE_SIZE - 16);
 }
 
 /// On a context switch, save any machine state, specific to this address
@@ -122,10 +164,246 @@ AddressSpace::SaveState()
 /// On a context switch, restore the machine state so that this address space
 /// can run.
 ///
-/// For now, tell the machine where to find the page table.
+/// For now, tell the machine where to find the page table, and to which
+/// space references belong if they are being recorded.
 void
 AddressSpace::RestoreState()
 {
-    machine->GetMMU()->pageTable     = pageTable;
-    machine->GetMMU()->pageTableSize = numPages;
+    MMU *mmu = machine->GetMMU();
+    mmu->pageTable     = pageTable;
+    mmu->pageTableSize = numPages;
+    if (mmu->referenceLog != nullptr)
+        mmu->referenceLog->SetSpace(id);
+}
+
+unsigned
+AddressSpace::GetId() const
+{
+    return id;
+}
+
+/// The mapping is placed at the lowest virtual pages past the program image
+/// that are free, reusing the ranges of earlier mappings, and its pages
+/// start out invalid: they are read from the file one at a time, as the
+/// program touches them (see `LoadPage`).
+int
+AddressSpace::Map(OpenFile *file)
+{
+    ASSERT(file != nullptr);
+
+    unsigned length = file->Length();
+    if (length == 0) {
+        delete file;
+        return -1;
+    }
+
+    MappedFile *mapping = new MappedFile;
+    mapping->file      = file;
+    mapping->length    = length;
+    mapping->numPages  = DivRoundUp(length, PAGE_SIZE);
+    mapping->firstPage = FindFreePages(mapping->numPages);
+    if (mappings.Add(mapping) == -1) {
+        delete mapping;
+        delete file;
+        return -1;
+    }
+
+    // Grow the page table if the region goes past its end.  Pages of a
+    // reused region were left invalid by `Unmap`.
+    if (mapping->firstPage + mapping->numPages > numPages)
+        ResizePageTable(mapping->firstPage + mapping->numPages);
+
+    DEBUG('a', "Mapped file of %u bytes at 0x%X, num pages %u\n",
+          length, mapping->firstPage * PAGE_SIZE, mapping->numPages);
+    return mapping->firstPage * PAGE_SIZE;
+}
+
+/// The virtual pages of the mapping are left invalid, so later accesses to
+/// them are reported as address errors by the page fault handler, until a
+/// later mapping reuses them.  If no mapping is left past them, the page
+/// table shrinks.
+bool
+AddressSpace::Unmap(unsigned addr)
+{
+    if (addr % PAGE_SIZE != 0)
+        return false;
+
+    int key = FindMapping(addr / PAGE_SIZE);
+    if (key == -1)
+        return false;
+    MappedFile *mapping = mappings.Get(key);
+    if (mapping->firstPage != addr / PAGE_SIZE)
+        return false;
+
+    for (unsigned i = 0; i < mapping->numPages; i++) {
+        unsigned vpn = mapping->firstPage + i;
+        if (pageTable[vpn].valid)
+            EvictPage(mapping, vpn);
+    }
+
+    DEBUG('a', "Unmapped file at 0x%X\n", addr);
+    mappings.Remove(key);
+    delete mapping->file;
+    delete mapping;
+
+    unsigned end = imagePages;
+    for (unsigned i = 0; i < mappings.SIZE; i++) {
+        if (!mappings.HasKey(i))
+            continue;
+        const MappedFile *m = mappings.Get(i);
+        if (m->firstPage + m->numPages > end)
+            end = m->firstPage + m->numPages;
+    }
+    if (end < numPages)
+        ResizePageTable(end);
+    return true;
+}
+
+bool
+AddressSpace::LoadPage(unsigned vpn)
+{
+    int key = FindMapping(vpn);
+    if (key == -1)
+        return false;
+    MappedFile *mapping = mappings.Get(key);
+
+    int frame = AllocateFrame();
+    if (frame == -1) {
+        DEBUG('a', "No frame for mapped page %u\n", vpn);
+        return false;
+    }
+    char *page = &machine->GetMMU()->mainMemory[frame * PAGE_SIZE];
+    unsigned offset = (vpn - mapping->firstPage) * PAGE_SIZE;
+
+    // The tail of the last page, past the end of the file, reads as zeros.
+    memset(page, 0, PAGE_SIZE);
+    mapping->file->ReadAt(page, PAGE_SIZE, offset);
+
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid        = true;
+    pageTable[vpn].use          = false;
+    pageTable[vpn].dirty        = false;
+
+    stats->numPageFaults++;
+    currentThread->usage.pageFaults++;
+    DEBUG('a', "Loaded mapped page %u into frame %d\n", vpn, frame);
+    return true;
+}
+
+int
+AddressSpace::FindMapping(unsigned vpn) const
+{
+    for (unsigned i = 0; i < mappings.SIZE; i++) {
+        if (!mappings.HasKey(i))
+            continue;
+        const MappedFile *mapping = mappings.Get(i);
+        if (vpn >= mapping->firstPage
+              && vpn < mapping->firstPage + mapping->numPages)
+            return i;
+    }
+    return -1;
+}
+
+/// Ranges are tried from the end of the program image up; whenever the
+/// candidate overlaps a mapping, it is moved right past it, so the result
+/// is the lowest free range.
+unsigned
+AddressSpace::FindFreePages(unsigned count) const
+{
+    unsigned first = imagePages;
+    bool moved;
+    do {
+        moved = false;
+        for (unsigned i = 0; i < mappings.SIZE; i++) {
+            if (!mappings.HasKey(i))
+                continue;
+            const MappedFile *m = mappings.Get(i);
+            if (m->firstPage < first + count
+                  && first < m->firstPage + m->numPages) {
+                first = m->firstPage + m->numPages;
+                moved = true;
+            }
+        }
+    } while (moved);
+    return first;
+}
+
+void
+AddressSpace::ResizePageTable(unsigned newNumPages)
+{
+    ASSERT(newNumPages >= imagePages);
+
+    TranslationEntry *newPageTable = new TranslationEntry[newNumPages];
+    for (unsigned i = 0; i < newNumPages; i++) {
+        if (i < numPages) {
+            newPageTable[i] = pageTable[i];
+            continue;
+        }
+        newPageTable[i].virtualPage  = i;
+        newPageTable[i].physicalPage = 0;
+        newPageTable[i].valid        = false;
+        newPageTable[i].use          = false;
+        newPageTable[i].dirty        = false;
+        newPageTable[i].readOnly     = false;
+    }
+    delete [] pageTable;
+    pageTable = newPageTable;
+    numPages  = newNumPages;
+    if (nextVictim >= numPages)
+        nextVictim = 0;
+
+    if (currentThread->space == this)
+        RestoreState();
+}
+
+/// Memory is only taken back from mapped pages: the program image itself is
+/// never paged out.  Victims are chosen round robin over the virtual pages.
+/// If memory is full and none of them is resident, there is nothing to do.
+int
+AddressSpace::AllocateFrame()
+{
+    int frame = frameMap->Find();
+    if (frame != -1)
+        return frame;
+
+    for (unsigned n = 0; n < numPages; n++) {
+        unsigned vpn = nextVictim;
+        nextVictim = (nextVictim + 1) % numPages;
+
+        if (!pageTable[vpn].valid)
+            continue;
+        int key = FindMapping(vpn);
+        if (key == -1)
+            continue;
+
+        EvictPage(mappings.Get(key), vpn);
+        frame = frameMap->Find();
+        ASSERT(frame != -1);
+        return frame;
+    }
+
+    return -1;
+}
+
+void
+AddressSpace::EvictPage(MappedFile *mapping, unsigned vpn)
+{
+    ASSERT(mapping != nullptr);
+    ASSERT(pageTable[vpn].valid);
+
+    unsigned frame = pageTable[vpn].physicalPage;
+    if (pageTable[vpn].dirty) {
+        // Never grow the file: only the bytes it had when mapped are
+        // written back.
+        unsigned offset = (vpn - mapping->firstPage) * PAGE_SIZE;
+        unsigned size = mapping->length - offset < PAGE_SIZE
+                      ? mapping->length - offset : PAGE_SIZE;
+        char *page = &machine->GetMMU()->mainMemory[frame * PAGE_SIZE];
+        mapping->file->WriteAt(page, size, offset);
+        DEBUG('a', "Wrote back mapped page %u from frame %u\n", vpn, frame);
+    }
+
+    pageTable[vpn].valid = false;
+    pageTable[vpn].dirty = false;
+    frameMap->Clear(frame);
 }
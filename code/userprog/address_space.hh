@@ -16,11 +16,26 @@
 
 #include "filesys/file_system.hh"
 #include "machine/translation_entry.hh"
+#include "lib/table.hh"
 
 
 const unsigned USER_STACK_SIZE = 1024;  ///< Increase this as necessary!
 
 
+/// A file mapped into an address space with `Mmap`.
+///
+/// The mapping covers the virtual pages `[firstPage, firstPage + numPages)`;
+/// page `i` of the mapping holds bytes `[i * PAGE_SIZE, (i + 1) * PAGE_SIZE)`
+/// of the file.
+class MappedFile {
+public:
+    OpenFile *file;      ///< Backing store; owned by the mapping.
+    unsigned length;     ///< Length of the file when it was mapped.
+    unsigned firstPage;  ///< First virtual page of the mapping.
+    unsigned numPages;   ///< Number of virtual pages of the mapping.
+};
+
+
 class AddressSpace {
 public:
 
@@ -47,14 +62,78 @@ public:
     void SaveState();
     void RestoreState();
 
+    /// Unique among the address spaces created so far.
+    unsigned GetId() const;
+
+    /// Map `file` at the lowest free virtual pages past the program image.
+    ///
+    /// The address space takes ownership of `file`.  Returns the virtual
+    /// address of the first byte of the mapping, or -1 on error.
+    int Map(OpenFile *file);
+
+    /// Remove the mapping starting at virtual address `addr`, writing dirty
+    /// pages back to the file.  Its virtual pages may be reused by later
+    /// mappings.
+    ///
+    /// Returns false if no mapping starts at `addr`.
+    bool Unmap(unsigned addr);
+
+    /// Bring virtual page `vpn` of a mapped file into memory, after a page
+    /// fault.
+    ///
+    /// Returns false if `vpn` does not belong to any mapping, or if memory
+    /// is full and no mapped page of this address space can be evicted.
+    bool LoadPage(unsigned vpn);
+
 private:
 
+    /// Find the mapping that contains virtual page `vpn`.
+    ///
+    /// Returns its key in `mappings`, or -1 if there is none.
+    int FindMapping(unsigned vpn) const;
+
+    /// Find the lowest `count` consecutive virtual pages past the program
+    /// image that belong to no mapping.  They may extend past the end of
+    /// the page table.
+    unsigned FindFreePages(unsigned count) const;
+
+    /// Make the page table cover `newNumPages` virtual pages, copying the
+    /// entries that remain and leaving new ones invalid.
+    void ResizePageTable(unsigned newNumPages);
+
+    /// Get a free physical page for a mapped page, evicting another mapped
+    /// page of this address space if memory is full.
+    ///
+    /// Returns -1 if there is no free page and nothing to evict.
+    int AllocateFrame();
+
+    /// Write virtual page `vpn` of `mapping` back to the file if it is
+    /// dirty, and release its physical page.
+    void EvictPage(MappedFile *mapping, unsigned vpn);
+
     /// Assume linear page table translation for now!
     TranslationEntry *pageTable;
 
     /// Number of pages in the virtual address space.
     unsigned numPages;
 
+    /// Number of pages of the program image and its stack; mappings go
+    /// after them.
+    unsigned imagePages;
+
+    /// Identifies this address space in the reference log.
+    unsigned id;
+
+    /// Identifier for the next address space to be created.
+    static unsigned nextId;
+
+    /// Files mapped with `Map`.
+    Table<MappedFile *> mappings;
+
+    /// Next virtual page to examine when looking for a mapped page to
+    /// evict.
+    unsigned nextVictim;
+
 };
 
 
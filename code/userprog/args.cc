@@ -16,7 +16,7 @@ static const unsigned MAX_ARG_LENGTH = 128;
 /// Count the number of arguments up to a null (which is not counted).
 ///
 /// Returns true if the number fit in the established limits and false if
-/// too many arguments were provided.
+/// too many arguments were provided, or they could not be read.
 static inline
 bool CountArgsToSave(int address, unsigned *count)
 {
@@ -26,7 +26,8 @@ bool CountArgsToSave(int address, unsigned *count)
     int val;
     unsigned c = 0;
     do {
-        machine->ReadMem(address + 4 * c, 4, &val);
+        if (!ReadUserMem(address + 4 * c, 4, &val))
+            return false;
         c++;
     } while (c < MAX_ARG_COUNT && val != 0);
     if (c == MAX_ARG_COUNT && val != 0)
@@ -58,15 +59,20 @@ SaveArgs(int address)
         args[i] = new char [MAX_ARG_LENGTH];
         int strAddr;
         // For each pointer, read the corresponding string.
-        machine->ReadMem(address + i * 4, 4, &strAddr);
-        ReadStringFromUser(strAddr, args[i], MAX_ARG_LENGTH);
+        if (!ReadUserMem(address + i * 4, 4, &strAddr) || strAddr == 0
+              || !ReadStringFromUser(strAddr, args[i], MAX_ARG_LENGTH)) {
+            for (unsigned j = 0; j <= i; j++)
+                delete [] args[j];
+            delete [] args;
+            return nullptr;
+        }
     }
     args[count] = nullptr;  // Write the trailing null.
 
     return args;
 }
 
-unsigned
+int
 WriteArgs(char **args)
 {
     ASSERT(args != nullptr);
@@ -93,9 +99,15 @@ WriteArgs(char **args)
     sp -= sp % 4;     // Align the stack to a multiple of four.
     sp -= c * 4 + 4;  // Make room for `argv`, including the trailing null.
     // Write each argument's address.
-    for (unsigned i = 0; i < c; i++)
-        machine->WriteMem(sp + 4 * i, 4, argsAddress[i]);
-    machine->WriteMem(sp + 4 * c, 4, 0);  // The last is null.
+    bool written = true;
+    for (unsigned i = 0; written && i < c; i++)
+        written = WriteUserMem(sp + 4 * i, 4, argsAddress[i]);
+    if (written)
+        written = WriteUserMem(sp + 4 * c, 4, 0);  // The last is null.
+    if (!written) {
+        DEBUG('e', "Error: cannot write `argv` at 0x%X.\n", sp);
+        return -1;
+    }
 
     machine->WriteRegister(STACK_REG, sp);
     return c;
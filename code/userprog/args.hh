@@ -60,8 +60,9 @@ char **SaveArgs(int address);
 /// * `args` is a kernel-space pointer to the start of an `argv`-like array.
 ///
 /// Returns the count of arguments, not including the trailing null (the
-/// same as `argc`).  Frees everything allocated by `SaveArgs`.
-unsigned WriteArgs(char **args);
+/// same as `argc`), or -1 if the stack cannot be written; the stack pointer
+/// is left untouched then.  Frees everything allocated by `SaveArgs`.
+int WriteArgs(char **args);
 
 
 #endif
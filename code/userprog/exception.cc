@@ -61,6 +61,32 @@ DefaultHandler(ExceptionType et)
     ASSERT(false);
 }
 
+/// Name of system call `scid`, for the trace.
+static const char *
+SyscallName(int scid)
+{
+    switch (scid) {
+        case SC_HALT:     return "Halt";
+        case SC_EXIT:     return "Exit";
+        case SC_EXEC:     return "Exec";
+        case SC_JOIN:     return "Join";
+        case SC_FORK:     return "Fork";
+        case SC_YIELD:    return "Yield";
+        case SC_SLEEP:    return "Sleep";
+        case SC_GETUSAGE: return "GetUsage";
+        case SC_CREATE:   return "Create";
+        case SC_REMOVE:   return "Remove";
+        case SC_OPEN:     return "Open";
+        case SC_CLOSE:    return "Close";
+        case SC_READ:     return "Read";
+        case SC_WRITE:    return "Write";
+        case SC_MMAP:     return "Mmap";
+        case SC_MUNMAP:   return "Munmap";
+        case SC_SYNC:     return "Sync";
+        default:          return "unknown";
+    }
+}
+
 /// Handle a system call exception.
 ///
 /// * `et` is the kind of exception.  The list of possible exceptions is in
@@ -81,11 +107,15 @@ static void
 SyscallHandler(ExceptionType _et)
 {
     int scid = machine->ReadRegister(2);
+    unsigned long start = stats->totalTicks;
 
     switch (scid) {
 
         case SC_HALT:
             DEBUG('e', "Shutdown, initiated by user program.\n");
+#ifdef FILESYS
+            bufferCache->Flush();
+#endif
             interrupt->Halt();
             break;
 
@@ -96,37 +126,160 @@ SyscallHandler(ExceptionType _et)
 
             char filename[FILE_NAME_MAX_LEN + 1];
             if (!ReadStringFromUser(filenameAddr, filename, sizeof filename))
-                DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n",
+                DEBUG('e', "Error: filename string too long"
+                           " (maximum is %u bytes).\n",
                       FILE_NAME_MAX_LEN);
 
             DEBUG('e', "`Create` requested for file `%s`.\n", filename);
             break;
         }
 
+        case SC_SLEEP: {
+            int ticks = machine->ReadRegister(4);
+            DEBUG('e', "`Sleep` requested for %d ticks.\n", ticks);
+            if (ticks > 0)
+                currentThread->SleepFor(ticks);
+            break;
+        }
+
+        case SC_GETUSAGE: {
+            int usageAddr = machine->ReadRegister(4);
+            int result = -1;
+
+            if (usageAddr == 0)
+                DEBUG('e', "Error: address to usage is null.\n");
+            else {
+                IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+                scheduler->ChargeCurrent();
+                interrupt->SetLevel(oldLevel);
+                const ThreadUsage &u = currentThread->usage;
+                const unsigned long fields[] = {
+                    u.userTicks, u.systemTicks, u.readyTicks, u.pageFaults,
+                    u.diskReads, u.diskWrites, u.voluntarySwitches,
+                    u.involuntarySwitches
+                };
+                static_assert(sizeof fields / sizeof *fields
+                                == sizeof (Usage) / sizeof (int),
+                              "`Usage` must have a field per counter");
+                result = 0;
+                for (unsigned i = 0; i < sizeof fields / sizeof *fields; i++) {
+                    if (!WriteUserMem(usageAddr + 4 * i, 4,
+                                      (int) fields[i])) {
+                        DEBUG('e', "Error: cannot write usage at 0x%X.\n",
+                              usageAddr + 4 * i);
+                        result = -1;
+                        break;
+                    }
+                }
+            }
+
+            machine->WriteRegister(2, result);
+            break;
+        }
+
         case SC_CLOSE: {
             int fid = machine->ReadRegister(4);
             DEBUG('e', "`Close` requested for id %u.\n", fid);
             break;
         }
 
+        case SC_SYNC:
+            DEBUG('e', "`Sync` requested.\n");
+#ifdef FILESYS
+            bufferCache->Flush();
+#endif
+            machine->WriteRegister(2, 0);
+            break;
+
+        case SC_MMAP: {
+            int filenameAddr = machine->ReadRegister(4);
+            char filename[FILE_NAME_MAX_LEN + 1];
+            int result = -1;
+
+            if (filenameAddr == 0)
+                DEBUG('e', "Error: address to filename string is null.\n");
+            else if (!ReadStringFromUser(filenameAddr, filename,
+                                         sizeof filename))
+                DEBUG('e', "Error: filename string too long"
+                           " (maximum is %u bytes).\n",
+                      FILE_NAME_MAX_LEN);
+            else {
+                DEBUG('e', "`Mmap` requested for file `%s`.\n", filename);
+                OpenFile *file = fileSystem->Open(filename);
+                if (file == nullptr)
+                    DEBUG('e', "Error: file `%s` not found.\n", filename);
+                else
+                    result = currentThread->space->Map(file);
+            }
+
+            machine->WriteRegister(2, result);
+            break;
+        }
+
+        case SC_MUNMAP: {
+            int addr = machine->ReadRegister(4);
+            DEBUG('e', "`Munmap` requested for address 0x%X.\n", addr);
+
+            int result = currentThread->space->Unmap(addr) ? 0 : -1;
+            if (result == -1)
+                DEBUG('e', "Error: no mapping starts at 0x%X.\n", addr);
+
+            machine->WriteRegister(2, result);
+            break;
+        }
+
         default:
             fprintf(stderr, "Unexpected system call: id %d.\n", scid);
             ASSERT(false);
 
     }
 
+    if (traceLog != nullptr)
+        traceLog->Span(FIRST_THREAD_TRACK + currentThread->id, "syscall",
+                       SyscallName(scid), start, stats->totalTicks);
     IncrementPC();
 }
 
+/// Handle a page fault exception.
+///
+/// Only pages of memory-mapped files are ever missing from memory; they are
+/// brought in from their file and the faulting instruction is retried (the
+/// program counter is left untouched).
+///
+/// If the page cannot be brought in (it is outside the address space, or
+/// memory is full of pages that cannot be evicted), the faulting thread is
+/// killed: its address space is released, writing mapped files back, and
+/// the rest of the machine goes on.
+static void
+PageFaultHandler(ExceptionType et)
+{
+    unsigned vaddr = machine->ReadRegister(BAD_VADDR_REG);
+    DEBUG('e', "Page fault at address 0x%X.\n", vaddr);
+
+    unsigned long start = stats->totalTicks;
+    if (!currentThread->space->LoadPage(vaddr / PAGE_SIZE)) {
+        fprintf(stderr, "Cannot serve page fault at 0x%X, killing thread"
+                        " \"%s\".\n", vaddr, currentThread->GetName());
+        scheduler->ForgetUserState(currentThread);
+        delete currentThread->space;
+        currentThread->space = nullptr;
+        currentThread->Finish();
+    }
+    if (traceLog != nullptr)
+        traceLog->Span(FIRST_THREAD_TRACK + currentThread->id, "fault",
+                       "page fault", start, stats->totalTicks,
+                       "vpn", vaddr / PAGE_SIZE);
+}
+
 
-/// By default, only system calls have their own handler.  All other
-/// exception types are assigned the default handler.
+/// By default, only system calls and page faults have their own handler.
+/// All other exception types are assigned the default handler.
 void
 SetExceptionHandlers()
 {
     machine->SetHandler(NO_EXCEPTION,            &DefaultHandler);
     machine->SetHandler(SYSCALL_EXCEPTION,       &SyscallHandler);
-    machine->SetHandler(PAGE_FAULT_EXCEPTION,    &DefaultHandler);
+    machine->SetHandler(PAGE_FAULT_EXCEPTION,    &PageFaultHandler);
     machine->SetHandler(READ_ONLY_EXCEPTION,     &DefaultHandler);
     machine->SetHandler(BUS_ERROR_EXCEPTION,     &DefaultHandler);
     machine->SetHandler(ADDRESS_ERROR_EXCEPTION, &DefaultHandler);
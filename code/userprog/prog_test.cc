@@ -36,6 +36,7 @@ StartProcess(const char *filename)
 
     delete executable;
 
+    scheduler->ClaimUserState();
     space->InitRegisters();  // Set the initial register values.
     space->RestoreState();   // Load page table register.
 
@@ -52,23 +53,39 @@ StartProcess(const char *filename)
 static Console   *console;
 static Semaphore *readAvail;
 static Semaphore *writeDone;
+static DeferredWork *readWork;
+static DeferredWork *writeWork;
 
 /// Console interrupt handlers.
 ///
-/// Wake up the thread that requested the I/O.
+/// Wake up the thread that requested the I/O, once interrupts are enabled.
+/// The console handles a single character each way at a time, so neither
+/// wake up is deferred while still queued.
 
 static void
-ReadAvail(void *arg)
+WakeReader(void *arg)
 {
     readAvail->V();
 }
 
 static void
-WriteDone(void *arg)
+WakeWriter(void *arg)
 {
     writeDone->V();
 }
 
+static void
+ReadAvail(void *arg)
+{
+    interrupt->Defer(readWork);
+}
+
+static void
+WriteDone(void *arg)
+{
+    interrupt->Defer(writeWork);
+}
+
 /// Test the console by echoing characters typed at the input onto the
 /// output.
 ///
@@ -79,6 +96,8 @@ ConsoleTest(const char *in, const char *out)
     console   = new Console(in, out, ReadAvail, WriteDone, 0);
     readAvail = new Semaphore("read avail", 0);
     writeDone = new Semaphore("write done", 0);
+    readWork  = new DeferredWork(WakeReader, nullptr);
+    writeWork = new DeferredWork(WakeWriter, nullptr);
 
     for (;;) {
         readAvail->P();        // Wait for character to arrive.
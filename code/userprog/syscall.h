@@ -25,12 +25,17 @@
 #define SC_JOIN     3
 #define SC_FORK     4
 #define SC_YIELD    5
+#define SC_SLEEP    6
+#define SC_GETUSAGE 7
 #define SC_CREATE  10
 #define SC_REMOVE  11
 #define SC_OPEN    12
 #define SC_CLOSE   13
 #define SC_READ    14
 #define SC_WRITE   15
+#define SC_MMAP    16
+#define SC_MUNMAP  17
+#define SC_SYNC    18
 
 
 #ifndef IN_ASM
@@ -66,8 +71,8 @@ SpaceId Exec(char *name);
 int Join(SpaceId id);
 
 
-/// User-level thread operations: `Fork` and `Yield`.  To allow multiple
-/// threads to run within a user program.
+/// User-level thread operations: `Fork`, `Yield` and `Sleep`.  To allow
+/// multiple threads to run within a user program.
 
 /// Fork a thread to run a procedure (`func`) in the *same* address space as
 /// the current thread.
@@ -77,8 +82,34 @@ int Fork(void (*func)(void));
 /// or not.
 void Yield();
 
+/// Block the calling thread for `ticks` ticks of simulated time, without
+/// using the CPU in the meantime.
+void Sleep(int ticks);
 
-/// File system operations: `Create`, `Open`, `Read`, `Write`, `Close`.
+
+/// Accounting: `GetUsage`.
+
+/// Resources used by a thread, as reported by `GetUsage`.  Times are in
+/// ticks.
+typedef struct {
+    int userTicks;            ///< Running user code.
+    int systemTicks;          ///< Running in the kernel.
+    int readyTicks;           ///< Ready, waiting for the CPU.
+    int pageFaults;
+    int diskReads;
+    int diskWrites;
+    int voluntarySwitches;    ///< Gave up the CPU by blocking.
+    int involuntarySwitches;  ///< Yielded or was preempted.
+} Usage;
+
+/// Fill `usage` with the resources used so far by the calling thread.
+///
+/// Return 0 on success, -1 if `usage` is null or cannot be written.
+int GetUsage(Usage *usage);
+
+
+/// File system operations: `Create`, `Open`, `Read`, `Write`, `Close`,
+/// `Sync`.
 ///
 /// These functions are patterned after UNIX -- files represent both files
 /// *and* hardware I/O devices.
@@ -122,6 +153,31 @@ int Read(char *buffer, int size, OpenFileId id);
 /// Close the file, we are done reading and writing to it.
 int Close(OpenFileId id);
 
+/// Write every modified file system block back to the disk; writes are
+/// otherwise delayed for a while.  Return 0.
+int Sync(void);
+
+
+/// Memory-mapped files: `Mmap` and `Munmap`.
+///
+/// Pages of a mapped file are loaded on demand, the first time the program
+/// touches them, and modified pages are written back into the file when the
+/// mapping is removed, when they are evicted to make room for other mapped
+/// pages, or when the program exits.
+
+/// Map the whole Nachos file `name` into the address space of the calling
+/// program.
+///
+/// Return the virtual address at which the file contents start, or -1 if
+/// the file cannot be opened or is empty.
+int Mmap(const char *name);
+
+/// Remove the mapping that starts at virtual address `addr`, as returned by
+/// `Mmap`.
+///
+/// Return 0 on success, -1 if there is no such mapping.
+int Munmap(int addr);
+
 
 #endif
 
@@ -8,6 +8,28 @@
 #include "threads/system.hh"
 
 
+bool ReadUserMem(int userAddress, unsigned size, int *value)
+{
+    ASSERT(value != nullptr);
+
+    MMU *mmu = machine->GetMMU();
+    ExceptionType e = mmu->ReadMem(userAddress, size, value);
+    if (e == PAGE_FAULT_EXCEPTION
+          && currentThread->space->LoadPage(userAddress / PAGE_SIZE))
+        e = mmu->ReadMem(userAddress, size, value);
+    return e == NO_EXCEPTION;
+}
+
+bool WriteUserMem(int userAddress, unsigned size, int value)
+{
+    MMU *mmu = machine->GetMMU();
+    ExceptionType e = mmu->WriteMem(userAddress, size, value);
+    if (e == PAGE_FAULT_EXCEPTION
+          && currentThread->space->LoadPage(userAddress / PAGE_SIZE))
+        e = mmu->WriteMem(userAddress, size, value);
+    return e == NO_EXCEPTION;
+}
+
 void ReadBufferFromUser(int userAddress, char *outBuffer,
                         unsigned byteCount)
 {
@@ -25,7 +47,8 @@ bool ReadStringFromUser(int userAddress, char *outString,
     do {
         int temp;
         count++;
-        ASSERT(machine->ReadMem(userAddress++, 1, &temp));
+        if (!ReadUserMem(userAddress++, 1, &temp))
+            return false;
         *outString = (unsigned char) temp;
     } while (*outString++ != '\0' && count < maxByteCount);
 
@@ -7,11 +7,23 @@
 #define NACHOS_USERPROG_TRANSFER__HH
 
 
+/// Read/write `size` (1, 2, or 4) bytes of user memory at `userAddress`.
+///
+/// Unlike `Machine::ReadMem`/`WriteMem`, no exception is raised.  A page
+/// of a mapped file that is not loaded yet is brought in, and the access
+/// retried once; only a second failure (or any other, such as an address
+/// out of the address space) is reported, by returning false.
+bool ReadUserMem(int userAddress, unsigned size, int *value);
+bool WriteUserMem(int userAddress, unsigned size, int value);
+
 /// Copy a byte array from virtual machine to host.
 void ReadBufferFromUser(int userAddress, char *outBuffer,
                         unsigned byteCount);
 
 /// Copy a C string from virtual machine to host.
+///
+/// Returns false if the string is longer than `maxByteCount` (including
+/// the terminating null) or cannot be read.
 bool ReadStringFromUser(int userAddress, char *outString,
                         unsigned maxByteCount);
 